@@ -25,7 +25,7 @@ private:
 		if (nearbyPlants.empty())
 			return;
 
-		m_closestEntityPos = m_positionCurrent;
+		m_closestEntityPos = positionCurrent();
 
 		int incrementer = 0;
 		for (const Plant* plant : nearbyPlants)
@@ -37,10 +37,10 @@ private:
 			m_collisionIndexes.add(incrementer);
 
 			float interaction = attractStrength;
-			if (abs(this->usi - plant->usi) > 2.f)
+			if (std::abs(this->usi - plant->usi) > 2.f)
 				interaction = -0.1f;
 
-			m_velocity += (plant->getPosition() - m_positionCurrent) * interaction;
+			velocity() += (plant->getPosition() - positionCurrent()) * interaction;
 
 			incrementer++;
 		}
@@ -69,9 +69,9 @@ public:
 		return *this;
 	}
 
-	static sf::Color generateColor()
+	static sf::Color generateColor(Random& rng)
 	{
-		sf::Color color = randColor(0, 100, 180, 255, 0, 100);
+		sf::Color color = randColor(rng, 0, 100, 180, 255, 0, 100);
 		color.a = 150; // transparancy
 		return color;
 	}
@@ -82,7 +82,7 @@ public:
 	void moveToCenter()
 	{
 		const sf::Vector2f center = { m_border->left + m_border->width / 2, m_border->top + m_border->height / 2 };
-		m_velocity += (center - m_positionCurrent) * 0.01f;
+		velocity() += (center - positionCurrent()) * 0.01f;
 	}
 
 
@@ -103,13 +103,15 @@ public:
 		this->reporoduce = false;
 		this->age = 0;
 
+		Random rng = Random::forEntity(vector_id, Random::PlantReproduce);
+
 		constexpr float va = 10.f;
-		const sf::Vector2f pos = m_positionCurrent + randVector(-va, va, -va, va);
+		const sf::Vector2f pos = positionCurrent() + randVector(rng, -va, va, -va, va);
 
 		plant->dead = false;
-		plant->m_clippingDisplacement = pos - plant->m_positionCurrent;
+		plant->clippingDisplacement() = pos - plant->positionCurrent();
 		plant->updateDisplacement();
-		plant->usi = usi + randfloat(-2, 2);
+		plant->usi = usi + randfloat(rng, -2, 2);
 	}
 
 	void wipeData()
@@ -124,12 +126,13 @@ public:
 	void createRandom()
 	{
 		// setting the position of the plant
-		const sf::Vector2f desiredPosition = randPosInRect(*m_border);
+		Random rng = Random::forEntity(vector_id, Random::PlantSpawn);
+		const sf::Vector2f desiredPosition = randPosInRect(rng, *m_border);
 
 		dead = false;
-		m_velocity = { 0.f, 0.f };
+		velocity() = { 0.f, 0.f };
 		updatePositionWithVelocity();
-		m_clippingDisplacement = desiredPosition - m_positionCurrent;
+		clippingDisplacement() = desiredPosition - positionCurrent();
 		updateDisplacement();
 	}
 
@@ -161,9 +164,11 @@ public:
 		if (age > reproAge && m_collisionIndexes.size < reproMinCollisions)
 			prepReproduction();
 
-		if (energy <= 0 || randint(0, randDeathChance) == 0)
+		Random rng = Random::forEntity(vector_id, Random::PlantUpdate);
+
+		if (energy <= 0 || randint(rng, 0, randDeathChance) == 0)
 			die();
 
-		age += randint(-10, 100);
+		age += randint(rng, -10, 100);
 	}
 };
\ No newline at end of file
@@ -3,9 +3,11 @@
 #include "SFML/Graphics.hpp"
 
 #include "entity.hpp"
-#include "plant.hpp"
+#include "Plant.hpp"
 #include "genome.hpp"
+#include "networkBatch.hpp"
 #include "../settings.hpp"
+#include "../simulation/handle.hpp"
 
 #include <nlohmann/json.hpp>
 
@@ -21,68 +23,120 @@ private:
 	static constexpr float K = 0.00054f;
 	static constexpr float reproThresh = 100.f;
 	float m_energy = initialEnergy;
+	float m_pendingEnergy = 0;
 	
 protected:
 	static constexpr float initialEnergy = 50.f;
 
 	void updateEnergy(const sf::Vector2f velocity, const float mass, const unsigned age, const unsigned nearby)
 	{
-		const float speed = abs(velocity.x) + abs(velocity.y);
+		const float speed = std::abs(velocity.x) + std::abs(velocity.y);
 		const float a_age = static_cast<float>(age) * 0.01f;
 		const float deltaEnergy = (mass + speed + a_age) * K;
-		m_energy -= deltaEnergy;
+		m_pendingEnergy -= deltaEnergy;
 	}
 
 	[[nodiscard]] bool reproCheck(const float mass) const { return m_energy > reproThresh; }
 	[[nodiscard]] float getEnergy() const { return m_energy; }
 	[[nodiscard]] bool energyDeathCheck() const { return m_energy <= 0.f; }
 
-	void setEnergy(const float newEnergy) { m_energy = newEnergy; }
+	void setEnergy(const float newEnergy) { m_energy = newEnergy; m_pendingEnergy = 0; }
 
-	void energyDiffusion(EnergyManagement& otherSystem, const float diffusion)
+	// during an update the energy is only read, every change is collected here and applied at the end of the update
+	void addPendingEnergy(const float delta) { m_pendingEnergy += delta; }
+	void applyPendingEnergy()
 	{
-		const float delta = (otherSystem.m_energy - this->m_energy) * diffusion;
-		this->m_energy += delta;
-		otherSystem.m_energy -= delta;
+		m_energy += m_pendingEnergy;
+		m_pendingEnergy = 0;
+	}
+
+	// returns the change in this system's energy, the change in the other system's energy is written to otherDelta
+	[[nodiscard]] float energyDiffusion(const EnergyManagement& otherSystem, const float diffusion, float& otherDelta) const
+	{
+		float thisEnergy = m_energy;
+		float otherEnergy = otherSystem.m_energy;
 
-		if (this->m_energy < 0)
+		const float delta = (otherEnergy - thisEnergy) * diffusion;
+		thisEnergy += delta;
+		otherEnergy -= delta;
+
+		if (thisEnergy < 0)
 		{
-			otherSystem.m_energy -= std::abs(this->m_energy);
-			this->m_energy = -0.1f;
-			otherSystem.m_energy += 0.1f;
+			otherEnergy -= std::abs(thisEnergy);
+			thisEnergy = -0.1f;
+			otherEnergy += 0.1f;
 		}
 
-		else if (otherSystem.m_energy < 0)
+		else if (otherEnergy < 0)
 		{
-			this->m_energy -= std::abs(otherSystem.m_energy);
-			otherSystem.m_energy = -0.1f;
-			this->m_energy += 0.1f;
+			thisEnergy -= std::abs(otherEnergy);
+			otherEnergy = -0.1f;
+			thisEnergy += 0.1f;
 		}
+
+		otherDelta = otherEnergy - otherSystem.m_energy;
+		return thisEnergy - m_energy;
 	}
 };
 
 
-class Cell : public Entity, public Genome, CellSettings, EnergyManagement, Perceptron
+class Cell;
+
+// what a cell did to the entities it touched during its update, applied to them once every cell has been updated
+struct CellContact
+{
+	EntityHandle cell{};
+	sf::Vector2f cellDisplacement{};
+	float cellEnergy = 0;
+
+	EntityHandle plant{};
+	sf::Vector2f plantDisplacement{};
+	float plantEnergy = 0;
+
+	// the entities the handles resolve to, nullptr for anything that has gone
+	void apply(Cell* touchedCell, Plant* touchedPlant) const;
+};
+
+
+// a cell's closest cell and plant, resolved from its handles by the world whenever the cell needs them
+struct Neighbours
+{
+	Cell* cell = nullptr;
+	Plant* plant = nullptr;
+};
+
+
+// every cell's brain, sized by CellSettings
+using CellPerceptron = FixedPerceptron<CellSettings::sensoryInputs, CellSettings::numHiddenLayers,
+                                       CellSettings::hiddenLayerSize, CellSettings::sensoryOutputs>;
+
+using CellNetworkBatch = NetworkBatch<CellSettings::sensoryInputs, CellSettings::numHiddenLayers,
+                                      CellSettings::hiddenLayerSize, CellSettings::sensoryOutputs>;
+
+
+class Cell : public Entity, public Genome, CellSettings, EnergyManagement, CellPerceptron
 {
 	unsigned m_timeAlone = 0;
 	unsigned m_reproduceCounter = 0;
 
-	Cell* m_closestCell = nullptr;
-	Plant* m_closestPlant = nullptr;
+	EntityHandle m_closestCell{};
+	EntityHandle m_closestPlant{};
 
 	float m_maxSpeed{};
 	float uniqueIdentifier{};
 
+	bool m_sawCell = false; // set by perceive(), the network only runs when there is a cell close enough to react to
+
 
 public:
 	unsigned offspringCount = 0;
 	unsigned vector_id = 0;
 
 	// constructor and destructor
-	explicit Cell(const Entity& entity = {}, const Genome& genome = Genome(), const unsigned Vector_id = 0)
-	: Entity(entity), Genome(genome), Perceptron(sensoryInputs, numHiddenLayers, hiddenLayerSize, sensoryOutputs), vector_id(Vector_id)
+	explicit Cell(const Entity& entity = {}, const Genome& genome = Genome(), const unsigned Vector_id = 0, Random& rng = Random::global())
+	: Entity(entity), Genome(genome), CellPerceptron(rng), vector_id(Vector_id)
 	{
-		setEntityRadius(m_entityRadius);
+		setEntityRadius(entityRadius());
 		uniqueIdentifier = generateUniqueIdentifier(getInputHiddenWeights());
 	}
 
@@ -92,7 +146,7 @@ public:
 			return *this;  // Check for self-assignment
 
 		Entity::operator=(other);
-		Perceptron::operator=(other);
+		CellPerceptron::operator=(other);
 
 		m_timeAlone        = other.m_timeAlone;
 		m_reproduceCounter = other.m_reproduceCounter;
@@ -134,16 +188,21 @@ public:
 	}
 
 
-	void setClosestEntities(Cell* closestCell, Plant* closestPlant, const unsigned nearbyCells, const unsigned nearbyPlants)
+	// nearby is what the two handles resolve to
+	void setClosestEntities(const EntityHandle closestCell, const EntityHandle closestPlant, const Neighbours& nearby,
+	                        const unsigned nearbyCells, const unsigned nearbyPlants)
 	{
 		m_closestCell  = closestCell;
 		m_closestPlant = closestPlant;
 		m_nearbyCells  = nearbyCells;
 		m_nearbyPlants = nearbyPlants;
 
-		setClosestPos();
+		setClosestPos(nearby);
 	}
 
+	[[nodiscard]] EntityHandle getClosestCell()  const { return m_closestCell; }
+	[[nodiscard]] EntityHandle getClosestPlant() const { return m_closestPlant; }
+
 	nlohmann::json saveCellJson()
 	{
 		return {
@@ -159,10 +218,11 @@ public:
 	void loadCellData(const nlohmann::json& cellData)
 	{
 		loadEntityData(cellData["entity data"]);
-		loadNetworkData(cellData["network data"]);
+		if (!loadNetworkData(cellData["network data"]))
+			std::cout << "saved network does not match the network size in CellSettings, keeping a random one" << "\n";
 		m_timeAlone        = cellData["time alone"];
 		m_reproduceCounter = cellData["reproduce counter"];
-		m_entityRadius     = cellData["radius"];
+		entityRadius()     = cellData["radius"];
 		dead = false;
 
 		setEnergy(cellData["energy"]);
@@ -176,39 +236,70 @@ public:
 		reporoduce = false;
 		offspringCount++;
 
+		// keyed on the parent, the slot the child lands in depends on the order of births
+		Random rng = Random::forEntity(vector_id, Random::CellReproduce);
+
 		constexpr float va = 3.f;
-		const sf::Vector2f pos = m_positionCurrent + randVector(-va, va, -va, va);
+		const sf::Vector2f pos = positionCurrent() + randVector(rng, -va, va, -va, va);
 
-		cell->m_velocity = m_velocity * -1.f;
+		cell->velocity() = velocity() * -1.f;
 		cell->updatePositionWithVelocity();
-		cell->m_clippingDisplacement = (pos - cell->m_positionCurrent);
+		cell->clippingDisplacement() = (pos - cell->positionCurrent());
 		cell->setEnergy(getEnergy());
 
-		cell->m_color = createMutatedColor(cell->m_color);
-		mutate(*cell);
+		cell->m_color = createMutatedColor(cell->m_color, rng);
+		mutate(*cell, rng);
 
 		cell->updateDisplacement();
-		cell->m_closestEntityPos = cell->m_positionCurrent;
+		cell->m_closestEntityPos = cell->positionCurrent();
 		cell->uniqueIdentifier = generateUniqueIdentifier(getInputHiddenWeights());
 	}
 
 
-	void update()
+	[[nodiscard]] const CellPerceptron& getNetwork() const { return *this; }
+	std::array<float, sensoryOutputs>& networkOutputs() { return weightedOutputs; }
+
+	// fills in the network inputs for this tick, returns false when there is no cell close enough and the network
+	// shouldn't be run, the outputs from the last time it ran are used instead
+	bool perceive(InputArray& inputs, const Neighbours& nearby)
+	{
+		m_sawCell = cellPerception(inputs, nearby);
+		return m_sawCell;
+	}
+
+	// runs the network straight away instead of through a NetworkBatch
+	template<Activation A>
+	void think(const InputArray& inputs) { this->template compute_output<A>(inputs); }
+
+	// first half of the update, once the network outputs are in. Only this cell is written to and what it does to its
+	// neighbours is recorded in the contact, this lets every cell be updated at the same time
+	void update(CellContact& contact, const Neighbours& nearby)
 	{
-		cellInteraction();
-		plantInteraction();
+		contact = {};
+
+		if (m_sawCell)
+			velocity() += (m_closestEntityPos - this->getPosition()) * weightedOutputs[0]; // interaction with cell
+		plantInteraction(nearby);
 
 		speed_limit(m_maxSpeed);
 		m_maxSpeed = weightedOutputs[2] * 10.f;
 		applyFriction(1 + std::abs(weightedOutputs[4]));
-		collisionManagement();
+		collisionManagement(contact, nearby);
 
 		// end of function statistics update
-		updateEnergy(m_velocity, m_entityRadius, age, m_nearbyCells);
+		updateEnergy(velocity(), entityRadius(), age, m_nearbyCells);
+	}
+
+	// second half of the update, run once every contact has been applied
+	void endUpdate()
+	{
+		applyPendingEnergy();
 		reproOrDeathCheck();
 		age++;
 	}
 
+	void addEnergy(const float delta) { addPendingEnergy(delta); }
+
 
 
 	void updatePositioning()
@@ -220,34 +311,39 @@ public:
 
 
 private:
-	void setClosestPos()
+	void setClosestPos(const Neighbours& nearby)
 	{
-		if (validateEntityPtr(m_closestCell))
-			m_closestEntityPos = m_closestCell->getPosition();
+		if (validateEntityPtr(nearby.cell))
+			m_closestEntityPos = nearby.cell->getPosition();
 		else
-			m_closestEntityPos = m_positionCurrent;
+			m_closestEntityPos = positionCurrent();
 
-		applyUpriciple(m_closestEntityPos.x);
-		applyUpriciple(m_closestEntityPos.y);
+		Random rng = Random::forEntity(vector_id, Random::Uncertainty);
+		applyUpriciple(m_closestEntityPos.x, rng);
+		applyUpriciple(m_closestEntityPos.y, rng);
 	}
 
-	void collisionManagement()
+	void collisionManagement(CellContact& contact, const Neighbours& nearby)
 	{
-		if (validateEntityPtr(m_closestCell))
+		if (validateEntityPtr(nearby.cell))
 		{
-			if (entityCollision(m_closestCell))
-				energyDiffusion(*m_closestCell, weightedOutputs[3]);
+			if (entityCollision(static_cast<const Entity*>(nearby.cell), contact.cellDisplacement))
+			{
+				contact.cell = m_closestCell;
+				addPendingEnergy(energyDiffusion(*nearby.cell, weightedOutputs[3], contact.cellEnergy));
+			}
 		}
 
 
-		if (validateEntityPtr(m_closestPlant))
+		if (validateEntityPtr(nearby.plant))
 		{
 
-			if (entityCollision(m_closestPlant))
+			if (entityCollision(static_cast<const Entity*>(nearby.plant), contact.plantDisplacement))
 			{
 				// transfer of nutrience upon contact
-				m_closestPlant->energy -= energyTransferRate;
-				setEnergy(getEnergy() + energyTransferRate);
+				contact.plant = m_closestPlant;
+				contact.plantEnergy = -energyTransferRate;
+				addPendingEnergy(energyTransferRate);
 			}
 		}
 	}
@@ -260,7 +356,7 @@ private:
 		if (m_reproduceCounter < reproductionDelay)
 			m_reproduceCounter++;
 		
-		if (reproCheck(m_entityRadius))
+		if (reproCheck(entityRadius()))
 		{
 			if (m_reproduceCounter >= reproductionDelay)
 			{
@@ -270,47 +366,45 @@ private:
 		}
 	}
 
-	void plantInteraction()
+	void plantInteraction(const Neighbours& nearby)
 	{
-		if (!validateEntityPtr(m_closestPlant))
+		if (!validateEntityPtr(nearby.plant))
 			return;
 
-		const sf::Vector2f direction = m_closestPlant->getPosition() - this->getPosition();
-		m_velocity += direction * weightedOutputs[1]; // interaction with plant
+		const sf::Vector2f direction = nearby.plant->getPosition() - this->getPosition();
+		velocity() += direction * weightedOutputs[1]; // interaction with plant
 	}
 
-	static void applyUpriciple(float& value)
+	static void applyUpriciple(float& value, Random& rng)
 	{
-		value += randfloat(-0.055f, 0.055f);
+		value += randfloat(rng, -0.055f, 0.055f);
 	}
 
 
-	void cellInteraction()
+	bool cellPerception(InputArray& inputs, const Neighbours& nearby)
 	{
 		// cell validation
-		if (!validateEntityPtr(m_closestCell))    { m_timeAlone++; return; }
+		if (!validateEntityPtr(nearby.cell))    { m_timeAlone++; return false; }
 		const float Celldist = distSquared(m_closestEntityPos, getPosition());
-		if (Celldist > (visualRadius - 7) * (visualRadius - 7))    { m_timeAlone++; return; }
+		if (Celldist > (visualRadius - 7) * (visualRadius - 7))    { m_timeAlone++; return false; }
 		m_timeAlone = 0;
 
 		// calculations for the cell
-		const sf::Vector2f cellDirection = m_closestEntityPos - this->getPosition();
-		const sf::Vector2f relCellDir = m_velocity - m_closestCell->getVelocity(); // relative velocity vector direction
+		const sf::Vector2f relCellDir = velocity() - nearby.cell->getVelocity(); // relative velocity vector direction
 		const float relativeCellSpeedSQ = relCellDir.x * relCellDir.x + relCellDir.y * relCellDir.y;
 
 		// calculations for the plant
 		float relPlantSpeed = 0; // by defualt 0
 		float PlantDist = 0;     //
-		if (validateEntityPtr(m_closestPlant))
+		if (validateEntityPtr(nearby.plant))
 		{
-			const sf::Vector2f relPlantDir = m_velocity - m_closestPlant->getVelocity(); // relative velocity vector direction
+			const sf::Vector2f relPlantDir = velocity() - nearby.plant->getVelocity(); // relative velocity vector direction
 			relPlantSpeed = relPlantDir.x * relPlantDir.x + relPlantDir.y * relPlantDir.y; // relative speed
-			PlantDist = distSquared(m_closestPlant->getPosition(), getPosition()); // relative plant distance
+			PlantDist = distSquared(nearby.plant->getPosition(), getPosition()); // relative plant distance
 		}
 
-		// todo: optimize
-		// calculating the computational output
-		const std::vector inputs = {
+		// the inputs of the network
+		inputs = {
 			Celldist             / 4000.f, // cell distance SQ
 			relativeCellSpeedSQ  / 5.f,   // direction to closest cell SQ
 			PlantDist            / 4000.f, // plant distance SQ
@@ -318,12 +412,26 @@ private:
 			getEnergy()          / 100.f,  // energy levels
 			static_cast<float>(m_nearbyCells)  / 10.f, // cell count
 			static_cast<float>(m_nearbyPlants) / 10.f,  // plant count
-			std::abs(m_closestCell->uniqueIdentifier - uniqueIdentifier) // similarity relation
+			std::abs(nearby.cell->uniqueIdentifier - uniqueIdentifier) // similarity relation
 		};
-	
-		this->compute_output(inputs);
 
-		m_velocity += cellDirection * weightedOutputs[0]; // interaction with cell
+		return true;
 	}
 
-};
\ No newline at end of file
+};
+
+
+inline void CellContact::apply(Cell* touchedCell, Plant* touchedPlant) const
+{
+	if (touchedCell != nullptr)
+	{
+		touchedCell->addDisplacement(cellDisplacement);
+		touchedCell->addEnergy(cellEnergy);
+	}
+
+	if (touchedPlant != nullptr)
+	{
+		touchedPlant->addDisplacement(plantDisplacement);
+		touchedPlant->energy += plantEnergy;
+	}
+}
@@ -1,6 +1,8 @@
 #pragma once
 
-#include "../buffer/Buffer.hpp"
+#include "../buffer/Allocations.hpp"
+#include "kinematics.hpp"
+#include "../simd/closestNeighbour.hpp"
 #include "SFML/Graphics.hpp"
 #include "../utility.hpp"
 
@@ -12,17 +14,13 @@ class Entity : public Allocations
 {
 
 protected:
-	sf::Vector2f m_positionBefore{};
-	sf::Vector2f m_positionCurrent{};
+	// positions, velocity, displacement and radius live in the world's Kinematics arrays, see kinematics.hpp
+	Kinematics* m_kinematics{};
+	unsigned m_slot = 0;
 
 	sf::Vector2f m_closestEntityPos{};
 
-	sf::Vector2f m_velocity{};
-	sf::Vector2f m_clippingDisplacement{};
-	sf::Vector2f m_deltaPos{};
-
 	const sf::Rect<float>* m_border{};
-	float m_entityRadius{};
 
 	bool dead = false;
 	bool reporoduce = false;
@@ -36,9 +34,12 @@ public:
 	unsigned m_nearbyCells = 0;
 	unsigned m_nearbyPlants = 0;
 
-	Entity(const Allocations& object = {}, const sf::Rect<float>* border = {}, const sf::Color& color = {}, const float radius = 0)
-	: Allocations(object), m_border(border), m_entityRadius(radius), m_color(color), m_originalColor(color)
+	Entity(const Allocations& object = {}, Kinematics* kinematics = {}, const unsigned slot = 0, const sf::Rect<float>* border = {},
+	       const sf::Color& color = {}, const float radius = 0)
+	: Allocations(object), m_kinematics(kinematics), m_slot(slot), m_border(border), m_color(color), m_originalColor(color)
 	{
+		if (m_kinematics != nullptr)
+			entityRadius() = radius;
 	}
 
 	Entity& operator=(const Entity& other)
@@ -46,14 +47,11 @@ public:
 		if (this == &other)
 			return *this;  // Check for self-assignment
 
-		m_positionBefore   = other.m_positionBefore;
-		m_positionCurrent  = other.m_positionCurrent;
+		// the slot this entity is stored in stays the same, only the state is copied across. The vertex range belongs
+		// to the slot as well so it isn't copied either
+		m_kinematics->copy(m_slot, *other.m_kinematics, other.m_slot);
 		m_closestEntityPos = other.m_closestEntityPos;
-		m_velocity         = other.m_velocity;
-		m_clippingDisplacement = other.m_clippingDisplacement;
-		m_deltaPos     = other.m_deltaPos;
 		m_border       = other.m_border;
-		m_entityRadius = other.m_entityRadius;
 		dead           = other.dead;
 		reporoduce     = other.reporoduce;
 		m_color        = other.m_color;
@@ -66,24 +64,25 @@ public:
 
 	static bool validateEntityPtr(const Entity* entityPtr) { return entityPtr != nullptr && entityPtr->isDead() == false; }
 
-	[[nodiscard]] sf::Vector2f getPosition()     const { return m_positionCurrent; }
+	[[nodiscard]] sf::Vector2f getPosition()     const { return positionCurrent(); }
 	[[nodiscard]] sf::Vector2f getClosestPos()   const { return m_closestEntityPos; }
-	[[nodiscard]] sf::Vector2f getVelocity()     const { return m_positionCurrent - m_positionBefore; }
-	[[nodiscard]] sf::Vector2f getDeltaPos()     const { return m_deltaPos; }
-	[[nodiscard]] sf::Vector2f getDisplacement() const { return m_clippingDisplacement; }
+	[[nodiscard]] sf::Vector2f getVelocity()     const { return positionCurrent() - positionBefore(); }
+	[[nodiscard]] sf::Vector2f getDisplacement() const { return clippingDisplacement(); }
 	[[nodiscard]] bool isDead() const { return dead; }
 	[[nodiscard]] bool shouldReproduce() const { return reporoduce; }
 
 	void setEntityPosition(const sf::Vector2f newPosition)
 	{
-		m_positionBefore = newPosition;
-		m_positionCurrent = newPosition;
+		positionBefore() = newPosition;
+		positionCurrent() = newPosition;
 		m_closestEntityPos = newPosition;
 	}
 
-	void setEntityRadius(const float radius) { m_entityRadius = radius; }
+	void setEntityRadius(const float radius) { entityRadius() = radius; }
+	void addDisplacement(const sf::Vector2f displacement) { clippingDisplacement() += displacement; }
 	void die() { dead = true; }
-	[[nodiscard]] float getRadius() const { return m_entityRadius; }
+	void revive() { dead = false; }
+	[[nodiscard]] float getRadius() const { return entityRadius(); }
 	[[nodiscard]] unsigned getAge() const { return age; }
 	[[nodiscard]] sf::Color getColor() const { return m_color; }
 
@@ -91,18 +90,18 @@ public:
 	[[nodiscard]] nlohmann::json saveEntityData() const
 	{
 		return {
-			{"position before",  vectorToJson(m_positionBefore)},
-			{"position current", vectorToJson(m_positionCurrent)},
-			{"velocity",         vectorToJson(m_velocity)},
+			{"position before",  vectorToJson(positionBefore())},
+			{"position current", vectorToJson(positionCurrent())},
+			{"velocity",         vectorToJson(velocity())},
 			{"color", colorToJson(m_color)}
 		};
 	}
 
 	void loadEntityData(const nlohmann::json& entityData)
 	{
-		m_positionBefore = jsonToVector(entityData["position before"]);
-		m_positionCurrent= jsonToVector(entityData["position current"]);
-		m_velocity       = jsonToVector(entityData["velocity"]);
+		positionBefore() = jsonToVector(entityData["position before"]);
+		positionCurrent()= jsonToVector(entityData["position current"]);
+		velocity()       = jsonToVector(entityData["velocity"]);
 		m_color          = jsonToColor(entityData["color"]);
 	}
 
@@ -111,45 +110,68 @@ public:
 protected:
 	unsigned age = 0;
 
+	// this entity's element of each Kinematics array
+	[[nodiscard]] const sf::Vector2f& positionBefore()       const { return m_kinematics->positionBefore[m_slot]; }
+	[[nodiscard]] const sf::Vector2f& positionCurrent()      const { return m_kinematics->positionCurrent[m_slot]; }
+	[[nodiscard]] const sf::Vector2f& velocity()             const { return m_kinematics->velocity[m_slot]; }
+	[[nodiscard]] const sf::Vector2f& clippingDisplacement() const { return m_kinematics->clippingDisplacement[m_slot]; }
+	[[nodiscard]] const float&        entityRadius()         const { return m_kinematics->radius[m_slot]; }
+
+	sf::Vector2f& positionBefore()       { return m_kinematics->positionBefore[m_slot]; }
+	sf::Vector2f& positionCurrent()      { return m_kinematics->positionCurrent[m_slot]; }
+	sf::Vector2f& velocity()             { return m_kinematics->velocity[m_slot]; }
+	sf::Vector2f& clippingDisplacement() { return m_kinematics->clippingDisplacement[m_slot]; }
+	float&        entityRadius()         { return m_kinematics->radius[m_slot]; }
+
 	void wipeEntityData()
 	{
 		age = 0;
 		dead = true;
 		reporoduce = false;
-		m_velocity = { 0, 0 };
-		m_clippingDisplacement = { 0, 0 };
+		velocity() = { 0, 0 };
+		clippingDisplacement() = { 0, 0 };
 	}
 
 	void prepReproduction() { reporoduce = true; }
-	void applyFriction(const float strength) { m_velocity /= strength; }
+	void applyFriction(const float strength) { velocity() /= strength; }
 
 	void updatePositionWithVelocity()
 	{
-		m_positionBefore = m_positionCurrent;
-		m_positionCurrent += m_velocity;
+		positionBefore() = positionCurrent();
+		positionCurrent() += velocity();
 	}
 
 	void updateDisplacement()
 	{
-		const sf::Vector2f originalDisp = m_clippingDisplacement;
-		m_positionCurrent += originalDisp;
+		const sf::Vector2f originalDisp = clippingDisplacement();
+		positionCurrent() += originalDisp;
 		border();
-		const sf::Vector2f deltaDisp = m_clippingDisplacement - originalDisp;
-		m_positionCurrent += deltaDisp;
+		const sf::Vector2f deltaDisp = clippingDisplacement() - originalDisp;
+		positionCurrent() += deltaDisp;
 
-
-		m_deltaPos = m_velocity + originalDisp + deltaDisp;
-		m_clippingDisplacement = { 0, 0 };
+		clippingDisplacement() = { 0, 0 };
 	}
 
 
 	bool entityCollision(Entity* entity)
+	{
+		sf::Vector2f otherDisplacement{};
+		if (!entityCollision(entity, otherDisplacement))
+			return false;
+
+		entity->clippingDisplacement() += otherDisplacement;
+		return true;
+	}
+
+
+	// the other entity is left untouched, the correction it needs is written to otherDisplacement instead
+	bool entityCollision(const Entity* entity, sf::Vector2f& otherDisplacement)
 	{
 		const float thisRad = getRadius();
 		const float otherRad = entity->getRadius();
 
-		const sf::Vector2f relative_position = entity->m_positionCurrent - m_positionCurrent;
-		const float dist_squared = distSquared(this->m_positionCurrent, entity->m_positionCurrent);
+		const sf::Vector2f relative_position = entity->positionCurrent() - positionCurrent();
+		const float dist_squared = distSquared(this->positionCurrent(), entity->positionCurrent());
 		const float sum_radii = thisRad + otherRad;
 
 		if (dist_squared >= sum_radii * sum_radii || dist_squared <= 0)
@@ -160,8 +182,8 @@ protected:
 		const sf::Vector2f correction = (sum_radii - dist) * normal_vector * 0.5f;
 
 		// Move the entities to prevent them from interpenetrating
-		m_clippingDisplacement -= correction * (thisRad / sum_radii);
-		entity->m_clippingDisplacement += correction * (otherRad / sum_radii);
+		clippingDisplacement() -= correction * (thisRad / sum_radii);
+		otherDisplacement = correction * (otherRad / sum_radii);
 
 		return true;
 	}
@@ -172,10 +194,10 @@ protected:
 	{
 		const float radius = getRadius();
 		const sf::Vector2f desiredPos = {
-			std::max(m_border->left + radius, std::min(m_positionCurrent.x, m_border->left + m_border->width - radius)),
-			std::max(m_border->top + radius, std::min(m_positionCurrent.y, m_border->top + m_border->height - radius))
+			std::max(m_border->left + radius, std::min(positionCurrent().x, m_border->left + m_border->width - radius)),
+			std::max(m_border->top + radius, std::min(positionCurrent().y, m_border->top + m_border->height - radius))
 		};
-		m_clippingDisplacement += desiredPos - m_positionCurrent;
+		clippingDisplacement() += desiredPos - positionCurrent();
 	}
 
 
@@ -184,61 +206,50 @@ protected:
 		const float radius = getRadius();
 		constexpr float buffer = 30.f;
 		constexpr float repel = 0.02f;
-		if (m_border->left + radius + buffer > m_positionCurrent.x)
-			m_velocity.x += repel;
+		if (m_border->left + radius + buffer > positionCurrent().x)
+			velocity().x += repel;
 
-		else if (m_border->left + m_border->width - (radius + buffer) < m_positionCurrent.x)
-			m_velocity.x -= repel;
+		else if (m_border->left + m_border->width - (radius + buffer) < positionCurrent().x)
+			velocity().x -= repel;
 
-		if (m_border->top + radius + buffer > m_positionCurrent.y)
-			m_velocity.y += repel;
+		if (m_border->top + radius + buffer > positionCurrent().y)
+			velocity().y += repel;
 
-		else if (m_border->top + m_border->height - (radius + buffer) < m_positionCurrent.y)
-			m_velocity.y -= repel;
+		else if (m_border->top + m_border->height - (radius + buffer) < positionCurrent().y)
+			velocity().y -= repel;
 	}
 
 
 	void speed_limit(const float maxSpeed)
 	{
-		const float speedSQ = m_velocity.x * m_velocity.x + m_velocity.y * m_velocity.y;
+		const float speedSQ = velocity().x * velocity().x + velocity().y * velocity().y;
 
 		if (speedSQ > maxSpeed * maxSpeed)
 		{
 			const float speed = sqrt(speedSQ);
-			m_velocity.x = (m_velocity.x / speed) * maxSpeed;
-			m_velocity.y = (m_velocity.y / speed) * maxSpeed;
+			velocity().x = (velocity().x / speed) * maxSpeed;
+			velocity().y = (velocity().y / speed) * maxSpeed;
 		}
 	}
 };
 
 
 
-template <class T>
-T* filterAndProcessNearby(const sf::Vector2f position, std::vector<T*>& entities, const float visualRange, const float radius, unsigned& closeCounter)
-{
-	/* in this function we will find the closest cell to this current cell, while doing that we will also preform collision detection
-	 */
-
-	T* closestEntity = nullptr;
-	float closestDistSq = visualRange * visualRange;
-
-	for (T* otherEntity : entities)
-	{
-		const sf::Vector2f otherPos = otherEntity->getPosition();
-		if (position == otherPos)
-			continue;
-
-		const float localDiam = radius + otherEntity->getRadius();
-		const float distSq = lengthSquared(otherPos - position) - (localDiam * localDiam);
+// returned by filterAndProcessNearby when nothing is in range
+inline constexpr unsigned noEntity = UINT32_MAX;
 
-		if (distSq < visualRange * visualRange) closeCounter++;
+// finds the closest of the nearby slots to position, reading straight from the kinematics arrays so the entities
+// themselves are never touched. The neighbours are packed into packed and handed to the closestNeighbour kernel.
+// Returns the slot of the closest entity or noEntity
+inline unsigned filterAndProcessNearby(const sf::Vector2f position, const std::vector<unsigned>& slots, const Kinematics& kinematics,
+                                       const float visualRange, const float radius, unsigned& closeCounter, PackedNeighbours& packed)
+{
+	packed.clear();
+	for (const unsigned slot : slots)
+		packed.add(kinematics.positionCurrent[slot], kinematics.radius[slot]);
 
-		if (distSq < closestDistSq)
-		{
-			closestEntity = otherEntity;
-			closestDistSq = distSq;
-		}
-	}
+	const ClosestNeighbour closest = closestNeighbour(packed, position, radius, visualRange);
+	closeCounter += closest.inRange;
 
-	return closestEntity;
-}
\ No newline at end of file
+	return closest.index == ClosestNeighbour::none ? noEntity : slots[closest.index];
+}
@@ -4,10 +4,13 @@
 #include "../utility.hpp"
 #include <nlohmann/json.hpp>
 
+#include <array>
 #include <vector>
 #include <cmath>
 #include <cassert>
+#include <span>
 #include "../settings.hpp"
+#include "../simd/activation.hpp"
 
 
 class Genome : GenomeSettings
@@ -16,50 +19,61 @@ public:
 	explicit Genome() = default;
 
 	// Quick functions
-    [[nodiscard]] static sf::Color& randCellColor()
+    [[nodiscard]] static sf::Color randCellColor(Random& rng)
 	{
-		sf::Color color = randColor();
+		sf::Color color = randColor(rng);
 		color.a = 85;
         return color;
 	}
-    [[nodiscard]] static float randRadius() { return randfloat(0.1f, 1.f); }
+    [[nodiscard]] static float randRadius(Random& rng) { return randfloat(rng, 0.1f, 1.f); }
 
 
 protected:
-	[[nodiscard]] static sf::Color createMutatedColor(const sf::Color& colorRef)
+	[[nodiscard]] static sf::Color createMutatedColor(const sf::Color& colorRef, Random& rng)
 	{
         return {
-            static_cast<sf::Uint8>(colorRef.r + randint(colorMR, -colorMR)),
-            static_cast<sf::Uint8>(colorRef.g + randint(colorMR, -colorMR)),
-            static_cast<sf::Uint8>(colorRef.b + randint(colorMR, -colorMR)),
+            static_cast<sf::Uint8>(colorRef.r + randint(rng, colorMR, -colorMR)),
+            static_cast<sf::Uint8>(colorRef.g + randint(rng, colorMR, -colorMR)),
+            static_cast<sf::Uint8>(colorRef.b + randint(rng, colorMR, -colorMR)),
             85,
         };
     }
 };
 
 
+template<unsigned Inputs, unsigned HiddenLayers, unsigned HiddenSize, unsigned Outputs>
+class FixedPerceptron;
+
+template<unsigned Inputs, unsigned HiddenLayers, unsigned HiddenSize, unsigned Outputs>
+class NetworkBatch;
+
+
+// the runtime sized network, cells use FixedPerceptron now but saves are still read through this one
 class Perceptron
 {
+    template<unsigned Inputs, unsigned HiddenLayers, unsigned HiddenSize, unsigned Outputs>
+    friend class FixedPerceptron;
+
 public:
     // Constructor takes number of input nodes, number of hidden layers, size of each hidden layer, and number of output nodes
     explicit Perceptron(const unsigned num_inputs = 0, const unsigned num_hidden_layers = 0, 
-        const unsigned hidden_layer_size = 0, const unsigned num_outputs = 0)
+        const unsigned hidden_layer_size = 0, const unsigned num_outputs = 0, Random& rng = Random::global())
         : m_numInputs(num_inputs), m_numHiddenLayers(num_hidden_layers), m_hiddenLayerSize(hidden_layer_size), m_numOutputs(num_outputs)
     {
         // Initialize weights for the connections between input layer and first hidden layer
         m_weightsInputHidden.resize(m_numInputs * m_hiddenLayerSize);
         for (unsigned i = 0; i < m_numInputs * m_hiddenLayerSize; ++i)
-            m_weightsInputHidden[i] = getRandWeight();
+            m_weightsInputHidden[i] = getRandWeight(rng);
 
         // Initialize weights for the connections between hidden layers
         m_weightsHiddenHidden.resize((m_numHiddenLayers - 1) * m_hiddenLayerSize * m_hiddenLayerSize);
         for (unsigned i = 0; i < (m_numHiddenLayers - 1) * m_hiddenLayerSize * m_hiddenLayerSize; ++i)
-            m_weightsHiddenHidden[i] = getRandWeight();
+            m_weightsHiddenHidden[i] = getRandWeight(rng);
 
         // Initialize weights for the connections between last hidden layer and output layer
         m_weightsHiddenOutput.resize(m_hiddenLayerSize * m_numOutputs);
         for (unsigned i = 0; i < m_hiddenLayerSize * m_numOutputs; ++i)
-            m_weightsHiddenOutput[i] = getRandWeight();
+            m_weightsHiddenOutput[i] = getRandWeight(rng);
 
         weightedOutputs.resize(m_numOutputs);
     }
@@ -142,27 +156,27 @@ public:
     }
 
     // Mutate the weights of the perceptron
-    void mutate(Perceptron& perceptronToMutate) const
+    void mutate(Perceptron& perceptronToMutate, Random& rng) const
     {
         // Iterate over the weights for the input layer and mutate each one with a certain probability
         for (unsigned i = 0; i < m_numInputs * m_hiddenLayerSize; ++i)
         {
-            if (randfloat(0.f, 1.f) < m_mutationRate)
-                perceptronToMutate.m_weightsInputHidden[i] = m_weightsInputHidden[i] + getRandWeight() * m_mutationRange;
+            if (randfloat(rng, 0.f, 1.f) < m_mutationRate)
+                perceptronToMutate.m_weightsInputHidden[i] = m_weightsInputHidden[i] + getRandWeight(rng) * m_mutationRange;
         }
 
         // Iterate over the weights for the connections between hidden layers and mutate each one with a certain probability
         for (unsigned i = 0; i < (m_numHiddenLayers - 1) * m_hiddenLayerSize * m_hiddenLayerSize; ++i)
         {
-            if (randfloat(0.f, 1.f) < m_mutationRate)
-                perceptronToMutate.m_weightsHiddenHidden[i] = m_weightsHiddenHidden[i] + getRandWeight() * m_mutationRange;
+            if (randfloat(rng, 0.f, 1.f) < m_mutationRate)
+                perceptronToMutate.m_weightsHiddenHidden[i] = m_weightsHiddenHidden[i] + getRandWeight(rng) * m_mutationRange;
         }
 
         // Iterate over the weights for the connections between the last hidden layer and output layer and mutate each one with a certain probability
         for (unsigned i = 0; i < m_hiddenLayerSize * m_numOutputs; ++i)
         {
-            if (randfloat(0.f, 1.f) < m_mutationRate)
-                perceptronToMutate.m_weightsHiddenOutput[i] = m_weightsHiddenOutput[i] + getRandWeight() * m_mutationRange;
+            if (randfloat(rng, 0.f, 1.f) < m_mutationRate)
+                perceptronToMutate.m_weightsHiddenOutput[i] = m_weightsHiddenOutput[i] + getRandWeight(rng) * m_mutationRange;
         }
     }
 
@@ -203,7 +217,7 @@ protected:
     std::vector<float>& getInputHiddenWeights() { return m_weightsInputHidden; }
 
 private:
-    static float getRandWeight() { return randfloat(-1.f, 1.f); }
+    static float getRandWeight(Random& rng) { return randfloat(rng, -1.f, 1.f); }
 
     static float sigmoid(const float x) { return 1.f / (1.f + std::exp(-x)); }
 
@@ -223,3 +237,160 @@ public:
     // Pre-making the output container
     std::vector<float> weightedOutputs;
 };
+
+
+/*
+    FixedPerceptron
+
+    the same network as Perceptron with every dimension known at compile time, the weights and outputs are std::arrays
+    so a cell's brain is stored inside the cell and compute_output() never touches the heap. The maths, the weight
+    layout, the order the weights are drawn from the rng and the save format are all identical to Perceptron, so a
+    cell behaves exactly the same with either one.
+*/
+template<unsigned Inputs, unsigned HiddenLayers, unsigned HiddenSize, unsigned Outputs>
+class FixedPerceptron
+{
+    static_assert(HiddenLayers >= 1, "the network needs at least one hidden layer");
+
+    // runs the same maths over the whole population, see networkBatch.hpp
+    friend class NetworkBatch<Inputs, HiddenLayers, HiddenSize, Outputs>;
+
+    static constexpr unsigned inputHiddenCount  = Inputs * HiddenSize;
+    static constexpr unsigned hiddenHiddenCount = (HiddenLayers - 1) * HiddenSize * HiddenSize;
+    static constexpr unsigned hiddenOutputCount = HiddenSize * Outputs;
+
+public:
+    using InputArray = std::array<float, Inputs>;
+
+    explicit FixedPerceptron(Random& rng = Random::global())
+    {
+        for (float& weight : m_weightsInputHidden)
+            weight = getRandWeight(rng);
+
+        for (float& weight : m_weightsHiddenHidden)
+            weight = getRandWeight(rng);
+
+        for (float& weight : m_weightsHiddenOutput)
+            weight = getRandWeight(rng);
+    }
+
+    // Compute output of the perceptron for a given set of inputs, each layer's weighted sums are put through the
+    // activation together
+    template<Activation A = Activation::Exact>
+    void compute_output(const InputArray& inputs)
+    {
+        std::array<float, HiddenSize> hiddenLayerOutputs;
+        for (unsigned i = 0; i < HiddenSize; ++i)
+        {
+            float weighted_sum = 0.f;
+            for (unsigned j = 0; j < Inputs; ++j)
+                weighted_sum += inputs[j] * m_weightsInputHidden[i * Inputs + j];
+
+            hiddenLayerOutputs[i] = weighted_sum;
+        }
+        activation::sigmoid<A>(hiddenLayerOutputs.data(), HiddenSize);
+
+        for (unsigned layer = 1; layer < HiddenLayers; ++layer)
+        {
+            const float* layerWeights = &m_weightsHiddenHidden[(layer - 1) * HiddenSize * HiddenSize];
+
+            std::array<float, HiddenSize> newHiddenLayerOutputs;
+            for (unsigned i = 0; i < HiddenSize; ++i)
+            {
+                float weighted_sum = 0.f;
+                for (unsigned j = 0; j < HiddenSize; ++j)
+                    weighted_sum += hiddenLayerOutputs[j] * layerWeights[i * HiddenSize + j];
+
+                newHiddenLayerOutputs[i] = weighted_sum;
+            }
+            activation::sigmoid<A>(newHiddenLayerOutputs.data(), HiddenSize);
+
+            hiddenLayerOutputs = newHiddenLayerOutputs;
+        }
+
+        for (unsigned i = 0; i < Outputs; ++i)
+        {
+            float weighted_sum = 0.f;
+            for (unsigned j = 0; j < HiddenSize; ++j)
+                weighted_sum += hiddenLayerOutputs[j] * m_weightsHiddenOutput[j * Outputs + i];
+
+            weightedOutputs[i] = weighted_sum;
+        }
+        activation::sigmoid<A>(weightedOutputs.data(), Outputs);
+
+        // Scale the output value to the range [-1, 1]
+        for (float& output : weightedOutputs)
+            output = 2.f * output - 1.f;
+    }
+
+    // Mutate the weights of the perceptron
+    void mutate(FixedPerceptron& perceptronToMutate, Random& rng) const
+    {
+        mutateWeights(m_weightsInputHidden, perceptronToMutate.m_weightsInputHidden, rng);
+        mutateWeights(m_weightsHiddenHidden, perceptronToMutate.m_weightsHiddenHidden, rng);
+        mutateWeights(m_weightsHiddenOutput, perceptronToMutate.m_weightsHiddenOutput, rng);
+    }
+
+    nlohmann::json saveNetworkJson() const
+    {
+        return {
+            {"num inputs", Inputs},
+            {"num hidden layers", HiddenLayers},
+            {"hidden layer size", HiddenSize},
+            {"num outputs", Outputs},
+            {"weights input-hidden", m_weightsInputHidden},
+            {"weights hidden-hidden", m_weightsHiddenHidden},
+            {"weights hidden-output", m_weightsHiddenOutput}
+        };
+    }
+
+    // saves are read into the runtime sized Perceptron first, this way older saves keep loading. The weights are only
+    // copied across when the saved network has the same dimensions, returns false if it didn't
+    bool loadNetworkData(const nlohmann::json& networkData)
+    {
+        Perceptron network;
+        network.loadNetworkData(networkData);
+        return loadNetwork(network);
+    }
+
+    bool loadNetwork(const Perceptron& network)
+    {
+        if (network.m_numInputs != Inputs || network.m_numHiddenLayers != HiddenLayers ||
+            network.m_hiddenLayerSize != HiddenSize || network.m_numOutputs != Outputs ||
+            network.m_weightsInputHidden.size() != inputHiddenCount ||
+            network.m_weightsHiddenHidden.size() != hiddenHiddenCount ||
+            network.m_weightsHiddenOutput.size() != hiddenOutputCount)
+            return false;
+
+        std::copy(network.m_weightsInputHidden.begin(), network.m_weightsInputHidden.end(), m_weightsInputHidden.begin());
+        std::copy(network.m_weightsHiddenHidden.begin(), network.m_weightsHiddenHidden.end(), m_weightsHiddenHidden.begin());
+        std::copy(network.m_weightsHiddenOutput.begin(), network.m_weightsHiddenOutput.end(), m_weightsHiddenOutput.begin());
+        return true;
+    }
+
+protected:
+    [[nodiscard]] std::span<const float> getInputHiddenWeights() const { return m_weightsInputHidden; }
+
+private:
+    static float getRandWeight(Random& rng) { return randfloat(rng, -1.f, 1.f); }
+
+    template<size_t N>
+    void mutateWeights(const std::array<float, N>& weights, std::array<float, N>& weightsToMutate, Random& rng) const
+    {
+        for (unsigned i = 0; i < N; ++i)
+        {
+            if (randfloat(rng, 0.f, 1.f) < m_mutationRate)
+                weightsToMutate[i] = weights[i] + getRandWeight(rng) * m_mutationRange;
+        }
+    }
+
+    std::array<float, inputHiddenCount>  m_weightsInputHidden{};
+    std::array<float, hiddenHiddenCount> m_weightsHiddenHidden{};
+    std::array<float, hiddenOutputCount> m_weightsHiddenOutput{};
+
+    static constexpr float m_mutationRate  = 0.30f;
+    static constexpr float m_mutationRange = 0.24f;
+
+public:
+    std::array<float, Outputs> weightedOutputs{};
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+
+#include <vector>
+
+/*
+	Kinematics
+
+	the physical state of every entity of one type, stored as one array per field and indexed by the entity's slot
+	(its vector_id). World owns one of these for the cells and one for the plants and Entity only keeps a pointer to
+	it and its slot, so the Cell / Plant API stays the same while the loops that run over every entity (prepGrid, the
+	neighbour scans) only pull in the fields they actually read instead of whole Cell objects, perceptron and all.
+
+	the arrays are sized once before any entity is created and never resized, they are indexed from several threads
+	at once but every slot is only ever written to by the thread that owns it.
+*/
+
+
+struct Kinematics
+{
+	std::vector<sf::Vector2f> positionBefore{};
+	std::vector<sf::Vector2f> positionCurrent{};
+	std::vector<sf::Vector2f> velocity{};
+	std::vector<sf::Vector2f> clippingDisplacement{};
+	std::vector<float>        radius{};
+
+	void resize(const size_t count)
+	{
+		positionBefore.resize(count);
+		positionCurrent.resize(count);
+		velocity.resize(count);
+		clippingDisplacement.resize(count);
+		radius.resize(count);
+	}
+
+	[[nodiscard]] size_t size() const { return positionCurrent.size(); }
+
+	// copies the state of one slot into another, the slots can belong to different Kinematics
+	void copy(const unsigned slot, const Kinematics& other, const unsigned otherSlot)
+	{
+		positionBefore[slot]       = other.positionBefore[otherSlot];
+		positionCurrent[slot]      = other.positionCurrent[otherSlot];
+		velocity[slot]             = other.velocity[otherSlot];
+		clippingDisplacement[slot] = other.clippingDisplacement[otherSlot];
+		radius[slot]               = other.radius[otherSlot];
+	}
+};
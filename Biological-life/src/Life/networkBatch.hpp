@@ -0,0 +1,196 @@
+#pragma once
+
+#include "genome.hpp"
+#include "../threading/ThreadPool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/*
+	NetworkBatch
+
+	runs the networks of the whole population in one go instead of one cell at a time. During perception every cell
+	hands its inputs to the batch, evaluate() then packs the cells that asked into a dense list and runs their
+	networks together, and the cells read their outputs back before they act.
+
+	the list is worked through in tiles of `tile` cells. A tile first gathers the inputs and weights of its cells
+	so every weight of the layer is one row across the tile (the weights of a layer are contiguous across the
+	population of the tile), then each layer is a run of short contiguous rows the compiler turns into vector
+	instructions instead of one tiny dot product per cell. Only the cells that asked are packed, so a sparse
+	population with most slots empty doesn't cost any more than a dense one.
+
+	every lane does the same float operations in the same order as FixedPerceptron::compute_output, so the outputs are
+	exactly the same as running the networks one by one. The activations of a whole row go through
+	activation::sigmoid together, with Activation::Fast or Tanh that is a vector loop as well.
+*/
+
+
+template<unsigned Inputs, unsigned HiddenLayers, unsigned HiddenSize, unsigned Outputs>
+class NetworkBatch
+{
+	using Network = FixedPerceptron<Inputs, HiddenLayers, HiddenSize, Outputs>;
+
+public:
+	static constexpr unsigned tile = 16; // cells evaluated together
+
+	using InputArray = typename Network::InputArray;
+	using OutputArray = std::array<float, Outputs>;
+
+	void resize(const unsigned slots)
+	{
+		m_inputs.assign(slots, {});
+		m_outputs.assign(slots, {});
+		m_requested.assign(slots, 0);
+		m_batch.reserve(slots);
+	}
+
+	// each slot is only ever written to by the thread that owns it, so cells can hand in their inputs in parallel
+	void request(const unsigned slot, const InputArray& inputs)
+	{
+		m_inputs[slot] = inputs;
+		m_requested[slot] = 1;
+	}
+
+	// called before the cells hand in their inputs, slots that don't ask this tick aren't evaluated
+	void clearRequests() { std::fill(m_requested.begin(), m_requested.end(), uint8_t{ 0 }); }
+
+	[[nodiscard]] bool isRequested(const unsigned slot) const { return m_requested[slot] != 0; }
+	[[nodiscard]] const OutputArray& getOutputs(const unsigned slot) const { return m_outputs[slot]; }
+
+	// getNetwork(slot) returns the network stored in that slot
+	template<Activation A, class GetNetwork>
+	void evaluate(GetNetwork&& getNetwork, ThreadPool& threadPool)
+	{
+		m_batch.clear();
+		for (unsigned slot{ 0 }; slot < static_cast<unsigned>(m_requested.size()); slot++)
+		{
+			if (m_requested[slot])
+				m_batch.push_back(slot);
+		}
+
+		const auto batchSize = static_cast<unsigned>(m_batch.size());
+		threadPool.dispatch((batchSize + tile - 1) / tile, [&](const unsigned start, const unsigned end, unsigned)
+		{
+			Tile packed;
+			for (unsigned i{ start }; i < end; i++)
+			{
+				const unsigned first = i * tile;
+				const unsigned count = std::min(tile, batchSize - first);
+
+				packed.gather(&m_batch[first], count, m_inputs, getNetwork);
+				packed.template evaluate<A>();
+				for (unsigned lane{ 0 }; lane < count; lane++)
+					packed.scatter(lane, m_outputs[m_batch[first + lane]]);
+			}
+		});
+	}
+
+
+private:
+	using Lanes = std::array<float, tile>;
+
+	// the inputs and weights of one tile of cells, one row per input / weight with a lane per cell
+	struct Tile
+	{
+		std::array<Lanes, Inputs> inputs;
+		std::array<Lanes, Network::inputHiddenCount> weightsInputHidden;
+		std::array<Lanes, Network::hiddenHiddenCount> weightsHiddenHidden;
+		std::array<Lanes, Network::hiddenOutputCount> weightsHiddenOutput;
+		std::array<Lanes, Outputs> outputs;
+
+		template<class GetNetwork>
+		void gather(const unsigned* slots, const unsigned count, const std::vector<InputArray>& slotInputs, GetNetwork& getNetwork)
+		{
+			// a part filled tile is padded with zeros, the padding lanes are never read back
+			if (count < tile)
+				*this = {};
+
+			for (unsigned lane{ 0 }; lane < count; lane++)
+			{
+				const Network& network = getNetwork(slots[lane]);
+				const InputArray& laneInputs = slotInputs[slots[lane]];
+
+				for (unsigned i{ 0 }; i < Inputs; i++)
+					inputs[i][lane] = laneInputs[i];
+
+				for (unsigned i{ 0 }; i < Network::inputHiddenCount; i++)
+					weightsInputHidden[i][lane] = network.m_weightsInputHidden[i];
+
+				for (unsigned i{ 0 }; i < Network::hiddenHiddenCount; i++)
+					weightsHiddenHidden[i][lane] = network.m_weightsHiddenHidden[i];
+
+				for (unsigned i{ 0 }; i < Network::hiddenOutputCount; i++)
+					weightsHiddenOutput[i][lane] = network.m_weightsHiddenOutput[i];
+			}
+		}
+
+		void scatter(const unsigned lane, OutputArray& laneOutputs) const
+		{
+			for (unsigned i{ 0 }; i < Outputs; i++)
+				laneOutputs[i] = outputs[i][lane];
+		}
+
+		template<Activation A>
+		void evaluate()
+		{
+			std::array<Lanes, HiddenSize> hidden;
+			for (unsigned i{ 0 }; i < HiddenSize; i++)
+			{
+				Lanes sum{};
+				for (unsigned j{ 0 }; j < Inputs; j++)
+				{
+					for (unsigned lane{ 0 }; lane < tile; lane++)
+						sum[lane] += inputs[j][lane] * weightsInputHidden[i * Inputs + j][lane];
+				}
+
+				hidden[i] = sum;
+				activation::sigmoid<A>(hidden[i].data(), tile);
+			}
+
+			for (unsigned layer{ 1 }; layer < HiddenLayers; layer++)
+			{
+				const unsigned layerStart = (layer - 1) * HiddenSize * HiddenSize;
+
+				std::array<Lanes, HiddenSize> nextHidden;
+				for (unsigned i{ 0 }; i < HiddenSize; i++)
+				{
+					Lanes sum{};
+					for (unsigned j{ 0 }; j < HiddenSize; j++)
+					{
+						for (unsigned lane{ 0 }; lane < tile; lane++)
+							sum[lane] += hidden[j][lane] * weightsHiddenHidden[layerStart + i * HiddenSize + j][lane];
+					}
+
+					nextHidden[i] = sum;
+					activation::sigmoid<A>(nextHidden[i].data(), tile);
+				}
+
+				hidden = nextHidden;
+			}
+
+			for (unsigned i{ 0 }; i < Outputs; i++)
+			{
+				Lanes sum{};
+				for (unsigned j{ 0 }; j < HiddenSize; j++)
+				{
+					for (unsigned lane{ 0 }; lane < tile; lane++)
+						sum[lane] += hidden[j][lane] * weightsHiddenOutput[j * Outputs + i][lane];
+				}
+
+				activation::sigmoid<A>(sum.data(), tile);
+
+				// Scale the output value to the range [-1, 1]
+				for (unsigned lane{ 0 }; lane < tile; lane++)
+					outputs[i][lane] = 2.f * sum[lane] - 1.f;
+			}
+		}
+	};
+
+
+	std::vector<InputArray>  m_inputs{};    // by slot
+	std::vector<OutputArray> m_outputs{};   // by slot
+	std::vector<uint8_t>     m_requested{}; // by slot
+	std::vector<unsigned>    m_batch{};     // the slots that asked this tick, in slot order
+};
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <vector>
+
+#include <algorithm>
+#include <cstdint>
+
+#include "spatialHashGrid.h"
+#include "../threading/ThreadPool.hpp"
+
+/*
+	CountingSortGrid
+
+	the same grid as SpatialHashGrid but stored compressed (CSR), every id lives in one contiguous array sorted by
+	grid cell and m_offsets[cell] .. m_offsets[cell + 1] is the range belonging to that cell. Nothing is ever dropped
+	and there is no per cell capacity, so the memory is only as big as the number of entities.
+
+	the grid is rebuilt with a counting sort split across the thread pool:
+	1. count   - every part of the item range counts how many of its items land in each grid cell
+	2. prefix  - the counts are turned into offsets, part by part inside each cell
+	3. scatter - every part writes its ids to the offsets it was given
+	the parts are contiguous ranges of the items, so the ids inside a cell always end up in item order no matter how
+	many threads were used.
+
+	cells in the same row are next to each other in the array, so a 3x3 query is only three contiguous ranges
+*/
+
+
+class CountingSortGrid
+{
+	static constexpr uint32_t invalidCell = UINT32_MAX;
+
+	std::vector<int32_t>  m_ids{};
+	std::vector<uint32_t> m_offsets{};     // cellCount + 1 entries
+
+	// scratch for the build
+	std::vector<uint32_t> m_itemCells{};   // the grid cell of every item, invalidCell when it is skipped
+	std::vector<int32_t>  m_itemIds{};
+	std::vector<uint32_t> m_partCounts{};  // parts * cellCount, counts and then write positions
+
+	uint32_t m_maxOccupancy = 0;           // the most ids in one grid cell after the last build
+
+
+public:
+	sf::Vector2u m_cellsXY{};
+	sf::Vector2f conversionFactor{};
+	sf::Vector2f m_cellDimensions{};
+	sf::Rect<float> m_screenSize{};
+
+	explicit CountingSortGrid(const sf::Rect<float> screenSize = {}, const sf::Vector2u cellsXY = {})
+	{
+		init(screenSize, cellsXY);
+	}
+
+
+	void init(const sf::Rect<float> screenSize, const sf::Vector2u cellsXY)
+	{
+		m_cellsXY = cellsXY;
+		m_screenSize = screenSize;
+
+		m_offsets.assign(static_cast<size_t>(m_cellsXY.x) * m_cellsXY.y + 1, 0);
+		m_ids.clear();
+
+		m_cellDimensions = { m_screenSize.width / static_cast<float>(m_cellsXY.x),
+							m_screenSize.height / static_cast<float>(m_cellsXY.y) };
+
+		conversionFactor = { 1.f / m_cellDimensions.x, 1.f / m_cellDimensions.y };
+	}
+
+
+	// getItem(index, position, id) fills in the item and returns false if the item should be left out of the grid
+	template<class GetItem>
+	void build(const unsigned itemCount, GetItem&& getItem, ThreadPool& threadPool)
+	{
+		const auto cellCount = static_cast<uint32_t>(m_offsets.size() - 1);
+		const unsigned parts = std::max(1u, std::min(threadPool.size(), itemCount));
+		const unsigned partSize = (itemCount + parts - 1) / std::max(1u, parts);
+
+		m_itemCells.resize(itemCount);
+		m_itemIds.resize(itemCount);
+		m_partCounts.assign(static_cast<size_t>(parts) * cellCount, 0);
+
+		// counting
+		threadPool.dispatch(parts, [&](const unsigned start, const unsigned end, unsigned)
+		{
+			for (unsigned part{ start }; part < end; part++)
+			{
+				uint32_t* counts = &m_partCounts[static_cast<size_t>(part) * cellCount];
+				const unsigned last = std::min(itemCount, (part + 1) * partSize);
+
+				for (unsigned i{ part * partSize }; i < last; i++)
+				{
+					sf::Vector2f position;
+					if (!getItem(i, position, m_itemIds[i]))
+					{
+						m_itemCells[i] = invalidCell;
+						continue;
+					}
+
+					m_itemCells[i] = idx2dTo1d(clampedIdx(position));
+					counts[m_itemCells[i]]++;
+				}
+			}
+		});
+
+		// prefix sum, the parts inside a cell are laid out in order so the sort is stable
+		uint32_t total = 0;
+		m_maxOccupancy = 0;
+		for (uint32_t cell{ 0 }; cell < cellCount; cell++)
+		{
+			m_offsets[cell] = total;
+			for (unsigned part{ 0 }; part < parts; part++)
+			{
+				uint32_t& count = m_partCounts[static_cast<size_t>(part) * cellCount + cell];
+				const uint32_t partCount = count;
+				count = total;
+				total += partCount;
+			}
+			m_maxOccupancy = std::max(m_maxOccupancy, total - m_offsets[cell]);
+		}
+		m_offsets[cellCount] = total;
+		m_ids.resize(total);
+
+		// scattering
+		threadPool.dispatch(parts, [&](const unsigned start, const unsigned end, unsigned)
+		{
+			for (unsigned part{ start }; part < end; part++)
+			{
+				uint32_t* writePositions = &m_partCounts[static_cast<size_t>(part) * cellCount];
+				const unsigned last = std::min(itemCount, (part + 1) * partSize);
+
+				for (unsigned i{ part * partSize }; i < last; i++)
+				{
+					if (m_itemCells[i] != invalidCell)
+						m_ids[writePositions[m_itemCells[i]]++] = m_itemIds[i];
+				}
+			}
+		});
+	}
+
+
+	// the results are written into the caller's container so any number of threads can query the grid at once
+	void find(const sf::Vector2f position, c_Vec& found) const
+	{
+		found.size = 0;
+
+		const sf::Vector2<uint32_t> cIdx = clampedIdx(position);
+		const uint32_t xStart = cIdx.x == 0 ? 0 : cIdx.x - 1;
+		const uint32_t xEnd = std::min(cIdx.x + 1, m_cellsXY.x - 1);
+		const uint32_t yStart = cIdx.y == 0 ? 0 : cIdx.y - 1;
+		const uint32_t yEnd = std::min(cIdx.y + 1, m_cellsXY.y - 1);
+
+		// each row of the 3x3 area is one contiguous range of ids
+		for (uint32_t y{ yStart }; y <= yEnd; y++)
+		{
+			const uint32_t first = m_offsets[idx2dTo1d({ xStart, y })];
+			const uint32_t last = m_offsets[idx2dTo1d({ xEnd, y }) + 1];
+
+			for (uint32_t i{ first }; i < last; i++)
+				found.add(m_ids[i]);
+		}
+	}
+
+	// visit(id) for every id in the grid cells that area touches, a row of cells is one contiguous range
+	template<class Visit>
+	void forEachInArea(const sf::Rect<float> area, Visit&& visit) const
+	{
+		const sf::Vector2<uint32_t> first = clampedIdx({ area.left, area.top });
+		const sf::Vector2<uint32_t> last = clampedIdx({ area.left + area.width, area.top + area.height });
+
+		for (uint32_t y{ first.y }; y <= last.y; y++)
+		{
+			const uint32_t begin = m_offsets[idx2dTo1d({ first.x, y })];
+			const uint32_t end = m_offsets[idx2dTo1d({ last.x, y }) + 1];
+
+			for (uint32_t i{ begin }; i < end; i++)
+				visit(m_ids[i]);
+		}
+	}
+
+	[[nodiscard]] uint32_t getGridCellCount() const { return static_cast<uint32_t>(m_offsets.size() - 1); }
+	[[nodiscard]] uint32_t getCellCount(const uint32_t cell) const { return m_offsets[cell + 1] - m_offsets[cell]; }
+	[[nodiscard]] uint32_t getMaxOccupancy() const { return m_maxOccupancy; }
+
+	[[nodiscard]] uint32_t idx2dTo1d(const sf::Vector2<uint32_t> idx) const
+	{
+		return idx.x + idx.y * m_cellsXY.x;
+	}
+
+	// positions outside of the grid are put in the nearest edge cell rather than throwing
+	[[nodiscard]] sf::Vector2<uint32_t> clampedIdx(const sf::Vector2f position) const
+	{
+		const float x = std::clamp(position.x * conversionFactor.x, 0.f, static_cast<float>(m_cellsXY.x - 1));
+		const float y = std::clamp(position.y * conversionFactor.y, 0.f, static_cast<float>(m_cellsXY.y - 1));
+		return { static_cast<uint32_t>(x), static_cast<uint32_t>(y) };
+	}
+
+
+	void reSize(const sf::Rect<float> screenSize)
+	{
+		init(screenSize, m_cellsXY);
+	}
+};
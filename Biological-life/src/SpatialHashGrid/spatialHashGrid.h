@@ -1,10 +1,13 @@
 #pragma once
 
-#include <SFML/Graphics.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Graphics/Rect.hpp>
 #include <vector>
 
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
+#include <stdexcept>
 /*
 	SpatialHashGrid
 
@@ -37,10 +40,21 @@ struct CollisionCell
 	uint8_t objects_count = 0;
 	int32_t objects[cell_capacity] = {};
 
+	// lossless cells keep everything past max_cell_idx in here instead of dropping it
+	std::vector<int32_t> spill{};
+	uint32_t total_count = 0; // every id added since the last clear, including dropped and spilled ones
+
 	CollisionCell() = default;
 
-	void addAtom(const int32_t id)
+	void addAtom(const int32_t id, const bool lossless = false)
 	{
+		total_count++;
+		if (lossless && objects_count == max_cell_idx)
+		{
+			spill.push_back(id);
+			return;
+		}
+
 		objects[objects_count] = id;
 		objects_count += objects_count < max_cell_idx;
 	}
@@ -48,28 +62,84 @@ struct CollisionCell
 	void clear()
 	{
 		objects_count = 0;
+		total_count = 0;
+		spill.clear();
 	}
 };
 
 
+// the results of a query, anything past max is kept in spill so no neighbour is ever dropped. spill is never shrunk,
+// setting size to 0 is enough to reuse it
 struct c_Vec
 {
 	static constexpr uint8_t max = CollisionCell::cell_capacity * 9;
 	int32_t array[max] = {};
-	uint8_t size = 0;
+	std::vector<int32_t> spill{};
+	uint32_t size = 0;
 
 	void add(const int32_t value)
 	{
-		if (size >= max)
-			return;
+		if (size < max)
+			array[size] = value;
+		else if (size - max < spill.size())
+			spill[size - max] = value;
+		else
+			spill.push_back(value);
 
-		array[size] = value;
 		size++;
 	}
 
 	[[nodiscard]] int32_t at(const unsigned index) const
 	{
-		return array[index];
+		return index < max ? array[index] : spill[index - max];
+	}
+};
+
+
+// how often grid cells went past what a fixed CollisionCell can hold, this is what hashGridCells should be sized by.
+// The grids gather the numbers while they are built so recording a rebuild doesn't visit every grid cell. The counting
+// sort grid has no capacity, only its max occupancy is recorded
+struct GridOverflowStats
+{
+	// the number of ids a fixed cell keeps before it starts dropping (or spilling) them
+	static constexpr uint32_t capacity = CollisionCell::max_cell_idx;
+
+	std::vector<uint32_t> cellOverflows{}; // per grid cell, the number of rebuilds it overflowed in
+	uint64_t rebuilds = 0;
+	uint64_t overflowedRebuilds = 0;       // rebuilds where at least one cell overflowed
+	uint64_t overflowedAtoms = 0;          // every id past capacity, summed over all rebuilds
+	uint32_t maxOccupancy = 0;
+
+	void reset(const size_t cellCount)
+	{
+		cellOverflows.assign(cellCount, 0);
+		rebuilds = 0;
+		overflowedRebuilds = 0;
+		overflowedAtoms = 0;
+		maxOccupancy = 0;
+	}
+
+	// overflowedCells are the grid cells that went past capacity in this rebuild and idsPastCapacity the ids they
+	// had past it
+	void record(const uint32_t cellCount, const uint32_t occupancy, const uint64_t idsPastCapacity,
+	            const std::vector<uint32_t>& overflowedCells = {})
+	{
+		if (cellOverflows.size() != cellCount)
+			reset(cellCount);
+
+		for (const uint32_t cell : overflowedCells)
+			cellOverflows[cell]++;
+
+		maxOccupancy = std::max(maxOccupancy, occupancy);
+		overflowedAtoms += idsPastCapacity;
+		rebuilds++;
+		overflowedRebuilds += !overflowedCells.empty();
+	}
+
+	// the grid cell that overflowed most often
+	[[nodiscard]] uint32_t worstCell() const
+	{
+		return static_cast<uint32_t>(std::max_element(cellOverflows.begin(), cellOverflows.end()) - cellOverflows.begin());
 	}
 };
 
@@ -80,12 +150,15 @@ struct SpatialHashGrid
 	sf::Vector2u m_cellsXY{};
 
 	sf::Vector2f conversionFactor{};
-	c_Vec found{};
 
-	// graphics
+	// dimensions, the grid lines themselves are drawn by Simulation
 	sf::Vector2f m_cellDimensions{};
 	sf::Rect<float> m_screenSize{};
-	sf::VertexBuffer m_renderGrid{};
+
+	// since the last clear, for GridOverflowStats
+	uint32_t m_maxOccupancy = 0;
+	uint64_t m_idsPastCapacity = 0;
+	std::vector<uint32_t> m_overflowedCells{};
 
 	// constructor and destructor
 	explicit SpatialHashGrid(const sf::Rect<float> screenSize = {}, const sf::Vector2u cellsXY = {})
@@ -106,13 +179,11 @@ struct SpatialHashGrid
 							m_screenSize.height / static_cast<float>(m_cellsXY.y) };
 
 		conversionFactor = { 1.f / m_cellDimensions.x, 1.f / m_cellDimensions.y };
-
-		initVertexBuffer();
 	}
 
 
 	// other functions
-	void addAtom(const sf::Vector2f pos, const int32_t atom)
+	void addAtom(const sf::Vector2f pos, const int32_t atom, const bool lossless = false)
 	{
 		const sf::Vector2<uint32_t> cIdx = posTo2dIdx(pos);
 
@@ -120,17 +191,31 @@ struct SpatialHashGrid
 			throw std::out_of_range("position argument out of range");
 
 		const uint32_t idx = idx2dTo1d(cIdx);
-		m_cells[idx].addAtom(atom);
+		CollisionCell& cell = m_cells[idx];
+		cell.addAtom(atom, lossless);
+
+		m_maxOccupancy = std::max(m_maxOccupancy, cell.total_count);
+		if (cell.total_count > GridOverflowStats::capacity)
+		{
+			m_idsPastCapacity++;
+			if (cell.total_count == GridOverflowStats::capacity + 1)
+				m_overflowedCells.push_back(idx);
+		}
 	}
 
 	void clear()
 	{
 		for (CollisionCell& cell : m_cells) {
-			cell.objects_count = 0;
+			cell.clear();
 		}
+
+		m_maxOccupancy = 0;
+		m_idsPastCapacity = 0;
+		m_overflowedCells.clear();
 	}
 
-	c_Vec& find(const sf::Vector2f position)
+	// the results are written into the caller's container so any number of threads can query the grid at once
+	void find(const sf::Vector2f position, c_Vec& found) const
 	{
 		found.size = 0;
 
@@ -147,10 +232,39 @@ struct SpatialHashGrid
 
 				for (unsigned i{0}; i < cell.objects_count; i++)
 					found.add(cell.objects[i]);
+
+				for (const int32_t id : cell.spill)
+					found.add(id);
 			}
 		}
+	}
 
-		return found;
+	// visit(id) for every id in the grid cells that area touches, unlike find() the area can go past the edges
+	template<class Visit>
+	void forEachInArea(const sf::Rect<float> area, Visit&& visit) const
+	{
+		const auto clampedIdx = [this](const sf::Vector2f position) -> sf::Vector2<uint32_t>
+		{
+			return {
+				static_cast<uint32_t>(std::clamp(position.x * conversionFactor.x, 0.f, static_cast<float>(m_cellsXY.x - 1))),
+				static_cast<uint32_t>(std::clamp(position.y * conversionFactor.y, 0.f, static_cast<float>(m_cellsXY.y - 1)))};
+		};
+		const sf::Vector2<uint32_t> first = clampedIdx({ area.left, area.top });
+		const sf::Vector2<uint32_t> last = clampedIdx({ area.left + area.width, area.top + area.height });
+
+		for (uint32_t y{ first.y }; y <= last.y; y++)
+		{
+			for (uint32_t x{ first.x }; x <= last.x; x++)
+			{
+				const CollisionCell& cell = m_cells[idx2dTo1d({ x, y })];
+
+				for (unsigned i{0}; i < cell.objects_count; i++)
+					visit(cell.objects[i]);
+
+				for (const int32_t id : cell.spill)
+					visit(id);
+			}
+		}
 	}
 
 	[[nodiscard]] uint32_t idx2dTo1d(const sf::Vector2<uint32_t> idx) const
@@ -171,34 +285,6 @@ struct SpatialHashGrid
 	}
 
 
-	void initVertexBuffer()
-	{
-		std::vector<sf::Vertex> vertices(static_cast<std::vector<sf::Vertex>::size_type>((m_cellsXY.x + m_cellsXY.y) * 2) + 10);
-
-		m_renderGrid = sf::VertexBuffer(sf::Lines, sf::VertexBuffer::Static);
-		m_renderGrid.create(vertices.size());
-
-		size_t counter = 0;
-		for (unsigned i = 0; i <= m_cellsXY.x; i++)
-		{
-			const float posX = static_cast<float>(i) * m_cellDimensions.x;
-			vertices[counter].position = { posX, 0 };
-			vertices[counter + 1].position = { m_screenSize.left + posX, m_screenSize.top + m_screenSize.height };
-			counter += 2;
-		}
-
-		for (unsigned i = 0; i <= m_cellsXY.y; i++)
-		{
-			const float posY = static_cast<float>(i) * m_cellDimensions.y;
-			vertices[counter].position = { 0, posY };
-			vertices[counter + 1].position = { m_screenSize.left + m_screenSize.width, m_screenSize.top + posY };
-			counter += 2;
-		}
-
-		m_renderGrid.update(vertices.data(), vertices.size(), 0);
-	}
-
-
 	void reSize(const sf::Rect<float> screenSize)
 	{
 		init(screenSize, m_cellsXY);
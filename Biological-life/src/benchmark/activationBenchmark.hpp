@@ -0,0 +1,82 @@
+#pragma once
+
+#include "../simd/activation.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+/*
+ * the "activation" benchmark mode, times each Activation over a large array and measures how far it strays from a
+ * double precision sigmoid, so the speed / accuracy trade off can be read off one report
+ */
+
+
+inline const char* activationName(const Activation mode)
+{
+	switch (mode)
+	{
+	case Activation::Exact: return "exact";
+	case Activation::Fast:  return "fast";
+	case Activation::Tanh:  return "tanh";
+	}
+	return "unknown";
+}
+
+
+template<Activation A>
+nlohmann::json measureActivation(const unsigned repeats)
+{
+	// max error over every float step of 1e-4 in [-40, 40], wider than any weighted sum the networks produce
+	double maxError = 0;
+	float worstInput = 0;
+	for (double x{ -40.0 }; x <= 40.0; x += 1e-4)
+	{
+		const auto input = static_cast<float>(x);
+		const double reference = 1.0 / (1.0 + std::exp(-static_cast<double>(input)));
+		const double error = std::abs(static_cast<double>(activation::sigmoid<A>(input)) - reference);
+		if (error > maxError)
+		{
+			maxError = error;
+			worstInput = input;
+		}
+	}
+
+	// throughput, the inputs sweep [-8, 8) the range the weighted sums usually land in
+	constexpr unsigned count = 1 << 16;
+	std::vector<float> inputs(count);
+	for (unsigned i{ 0 }; i < count; i++)
+		inputs[i] = -8.f + 16.f * static_cast<float>(i) / static_cast<float>(count);
+
+	std::vector<float> values(count);
+	double checksum = 0; // stops the work being optimised away
+	double seconds = 0;
+	for (unsigned r{ 0 }; r < repeats; r++)
+	{
+		values = inputs;
+		const auto start = std::chrono::steady_clock::now();
+		activation::sigmoid<A>(values.data(), count);
+		seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		checksum += values[r % count];
+	}
+
+	return {
+		{"activation", activationName(A)},
+		{"max abs error", maxError},
+		{"worst input", worstInput},
+		{"ns per value", seconds * 1e9 / (static_cast<double>(count) * repeats)},
+		{"checksum", checksum}
+	};
+}
+
+
+inline nlohmann::json runActivationBenchmark(const unsigned repeats)
+{
+	return nlohmann::json::array({
+		measureActivation<Activation::Exact>(repeats),
+		measureActivation<Activation::Fast>(repeats),
+		measureActivation<Activation::Tanh>(repeats)
+	});
+}
@@ -0,0 +1,163 @@
+#include "scenarios.hpp"
+#include "activationBenchmark.hpp"
+#include "../simulation/World.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <string>
+
+/*
+ * benchmark entry point, builds each scenario from a fixed seed, runs it for a fixed number of ticks and reports
+ * ticks/sec, the time spent in every tick phase and the entity counts as JSON
+ * the JSON only goes to the output file, stdout carries World's own logging
+ * usage: Biological-life-benchmark [scenario|all] [ticks] [seed] [output file] [threads]
+ *
+ * "activation" in place of a scenario runs the sigmoid microbenchmark instead, ticks is then the number of repeats
+ */
+
+
+struct PopulationStats
+{
+	unsigned min = std::numeric_limits<unsigned>::max();
+	unsigned max = 0;
+	double sum = 0;
+
+	void add(const unsigned count)
+	{
+		min = std::min(min, count);
+		max = std::max(max, count);
+		sum += count;
+	}
+
+	[[nodiscard]] nlohmann::json toJson(const unsigned final, const unsigned long long ticks) const
+	{
+		return {
+			{"final", final},
+			{"min", min},
+			{"max", max},
+			{"mean", ticks == 0 ? 0.0 : sum / static_cast<double>(ticks)}
+		};
+	}
+};
+
+
+nlohmann::json runScenario(const Scenario& scenario, const unsigned long long ticks, const uint64_t seed, const unsigned threads)
+{
+	Random::setSeed(seed);
+
+	Settings settings = scenario.settings;
+	settings.threadCount = threads;
+	World world(settings);
+
+	PopulationStats cells;
+	PopulationStats plants;
+
+	const auto start = std::chrono::steady_clock::now();
+	auto lastTick = start;
+	for (unsigned long long i{ 0 }; i < ticks; i++)
+	{
+		const auto now = std::chrono::steady_clock::now();
+		world.tick(std::chrono::duration<double>(now - lastTick).count());
+		lastTick = now;
+
+		cells.add(world.getCellCount());
+		plants.add(world.getPlantCount());
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	nlohmann::json phases = nlohmann::json::object();
+	const Profiler& profiler = world.getProfiler();
+	for (unsigned i{ 0 }; i < static_cast<unsigned>(Phase::Count); i++)
+	{
+		const auto phase = static_cast<Phase>(i);
+		if (profiler.getCount(phase) == 0)
+			continue;
+
+		phases[phaseName(phase)] = {
+			{"total ms", profiler.getTotalMs(phase)},
+			{"mean us", profiler.getTotalMs(phase) * 1'000.0 / static_cast<double>(profiler.getCount(phase))}
+		};
+	}
+
+	const GridOverflowStats& overflow = world.getGridOverflow();
+	const nlohmann::json gridOverflow = {
+		{"rebuilds", overflow.rebuilds},
+		{"overflowed rebuilds", overflow.overflowedRebuilds},
+		{"ids past capacity", overflow.overflowedAtoms},
+		{"max occupancy", overflow.maxOccupancy},
+		{"worst cell", overflow.rebuilds == 0 ? 0 : overflow.worstCell()},
+		{"worst cell overflows", overflow.rebuilds == 0 ? 0 : overflow.cellOverflows[overflow.worstCell()]}
+	};
+
+	return {
+		{"scenario", scenario.name},
+		{"description", scenario.description},
+		{"seed", seed},
+		{"threads", world.getThreadCount()},
+		{"ticks", ticks},
+		{"seconds", seconds},
+		{"ticks per sec", static_cast<double>(ticks) / seconds},
+		{"phases", phases},
+		{"cells", cells.toJson(world.getCellCount(), ticks)},
+		{"plants", plants.toJson(world.getPlantCount(), ticks)},
+		{"extinctions", world.getTotalExtinctions()},
+		{"grid overflow", gridOverflow},
+		{"checksum", world.computeChecksum()}
+	};
+}
+
+
+int main(const int argc, char* argv[])
+{
+	const std::string chosen = argc > 1 ? argv[1] : "all";
+	const std::string outputName = argc > 4 ? argv[4] : "benchmark.json";
+	uint64_t ticks = 2'000;
+	uint64_t seed = 12345;
+	uint64_t threads = 0;
+
+	const bool valid = argc <= 6 &&
+		(argc <= 2 || parseArgument(argv[2], ticks)) &&
+		(argc <= 3 || parseArgument(argv[3], seed)) &&
+		(argc <= 5 || parseArgument(argv[5], threads, ThreadPool::maxThreads));
+	if (!valid)
+	{
+		std::cerr << "usage: Biological-life-benchmark [scenario|all] [ticks] [seed] [output file] [threads]" << "\n";
+		std::cerr << "ticks, seed and threads are whole numbers, threads is at most " << ThreadPool::maxThreads << " (0 uses every hardware thread)" << "\n";
+		return 1;
+	}
+
+	nlohmann::json results = nlohmann::json::array();
+	if (chosen == "activation")
+	{
+		std::cerr << "running the activation benchmark " << ticks << " times" << "\n";
+		results = runActivationBenchmark(static_cast<unsigned>(ticks));
+	}
+	else
+	{
+		for (const Scenario& scenario : getScenarios())
+		{
+			if (chosen != "all" && chosen != scenario.name)
+				continue;
+
+			std::cerr << "running " << scenario.name << " for " << ticks << " ticks" << "\n";
+			results.push_back(runScenario(scenario, ticks, seed, static_cast<unsigned>(threads)));
+		}
+	}
+
+	if (results.empty())
+	{
+		std::cerr << "unknown scenario: " << chosen << "\n";
+		return 1;
+	}
+
+	const std::string output = results.dump(3);
+	std::ofstream ofs(outputName);
+	ofs << output;
+	ofs.close();
+
+	std::cerr << "results written to " << outputName << "\n";
+	return 0;
+}
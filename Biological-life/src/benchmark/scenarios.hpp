@@ -0,0 +1,111 @@
+#pragma once
+
+#include "../settings.hpp"
+
+#include <string>
+#include <vector>
+
+/*
+ * canned worlds used by the benchmark executable, every scenario is run from a fixed seed so the numbers produced by
+ * two builds can be compared directly
+ */
+
+
+struct Scenario
+{
+	std::string name;
+	std::string description;
+	Settings settings;
+};
+
+
+inline std::vector<Scenario> getScenarios()
+{
+	std::vector<Scenario> scenarios;
+
+	// exactly what main.cpp runs
+	scenarios.push_back({ "default", "the default main.cpp settings", defaultSettings() });
+
+	// the default world on the counting sort grid, to compare against the fixed capacity grid
+	Settings countingSort = defaultSettings();
+	countingSort.gridBackend = GridBackend::CountingSort;
+	scenarios.push_back({ "counting-sort-grid", "the default settings using the CSR CountingSortGrid", countingSort });
+
+	// the default world with every cell running its own network, to compare against the batched inference
+	Settings unbatched = defaultSettings();
+	unbatched.batchedInference = false;
+	scenarios.push_back({ "unbatched-inference", "the default settings with each cell running its own network", unbatched });
+
+	// the default world with the approximate sigmoid, to compare against the exact one
+	Settings fastActivation = defaultSettings();
+	fastActivation.activation = Activation::Fast;
+	scenarios.push_back({ "fast-activation", "the default settings using the polynomial sigmoid", fastActivation });
+
+	// every cell slot filled inside a world a quarter of the default size
+	scenarios.push_back({ "dense", "10k cells crowded into a small world", Settings(
+		1650,
+		Settings::maxCells,
+		500,
+
+		true,
+		false,
+
+		{ 900, 500 },
+		0.100f,
+		1500,
+		{ 20, 30, 50 },
+		"dense",
+
+		20,
+		1'000,
+
+		"benchmark_dense.json",
+		{ 25 , 15 }
+	) });
+
+	// very little food, cells have to travel to find plants
+	scenarios.push_back({ "sparse-plants", "a few hundred plants spread over the default world", Settings(
+		300,
+		3'000,
+		500,
+
+		true,
+		false,
+
+		{ 1800, 1000 },
+		0.100f,
+		2240,
+		{ 20, 30, 50 },
+		"sparse-plants",
+
+		20,
+		100,
+
+		"benchmark_sparse.json",
+		{ 25 , 15 }
+	) });
+
+	// a handful of cells and no food to speak of, the population dies out and is reset over and over
+	scenarios.push_back({ "extinctions", "small starving populations repeatedly reset by autoExtinctionReset", Settings(
+		20,
+		40,
+		500,
+
+		true,
+		false,
+
+		{ 1800, 1000 },
+		0.100f,
+		2240,
+		{ 20, 30, 50 },
+		"extinctions",
+
+		20,
+		10,
+
+		"benchmark_extinctions.json",
+		{ 25 , 15 }
+	) });
+
+	return scenarios;
+}
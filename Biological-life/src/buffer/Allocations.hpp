@@ -0,0 +1,13 @@
+#pragma once
+
+
+ /* An Allocations is the objects something owns in a Buffer, the range first .. first + count. The Buffer works out
+  * where their vertices go, an entity always owns just the one object */
+struct Allocations
+{
+	unsigned first = 0;
+	unsigned count = 0;
+
+	[[nodiscard]] unsigned end() const { return first + count; }
+	[[nodiscard]] const Allocations& getAllocations() const { return *this; }
+};
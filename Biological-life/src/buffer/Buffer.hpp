@@ -1,29 +1,63 @@
 #pragma once
 #include <SFML/Graphics.hpp>
+#include "Allocations.hpp"
+
+#include <cstdint>
 
 /*
- * TODO:
- * - apon generation, turn all of the vertecies into circle molds so they can be processed
- * - fix the removal bug
+ * every object is kept as one Instance, where it is, how big it is and its color. Moving or recoloring an object only
+ * writes its Instance however many vertices it has, expand() builds the vertices from the Instances afterwards.
+ *
+ * when the circle shader is used every object is a single quad and the shader cuts the circle out of it, otherwise
+ * it is the usual fan of objectPoints triangles. setDetail() swaps that for fewer triangles or a single point when
+ * the objects are too small on screen for the difference to show, the vertex buffer is sized for full detail
+ *
+ * only the objects placed with setShape() since the last arrange() are drawn. arrange() packs them at the front of the
+ * vertex buffer, an object that isn't placed any more is replaced by the last one drawn, so the draw call only ever
+ * covers the objects that are actually there.
  *
  * Update optimisation:
- * - keep track of what verticies indexes have been updated up until the user calles the update function
- * - then clear the container
+ * every object that is written to or moved in the drawing order is flagged as dirty, expand() only rebuilds the
+ * dirty objects and update() only uploads the runs of dirty objects before clearing the flags. Objects that sit still
+ * cost nothing per frame
+ *
+ * a frame goes: setShape() for everything to draw, arrange(), expand() (can be split between threads), update()
  */
 
 
- /* An Allocations is a class that manipulates Vertices inside of the VertexBuffer */
-struct Allocations
-{
-	std::vector<unsigned> indexes;
-};
-
 
 class Buffer
 {
+public:
+	enum class Detail : uint8_t
+	{
+		Point, // one vertex
+		Low,   // lowDetailPoints triangles, or the shaded quad
+		Full   // objectPoints triangles, or the shaded quad
+	};
+
+private:
+	// one of these per object, 16 bytes
+	struct Instance
+	{
+		sf::Vector2f position{};
+		float radius = 0;
+		sf::Color color = sf::Color::Transparent;
+	};
+
+	sf::Shader m_circleShader;
+	const bool m_shadedCircles;
+
+	static constexpr unsigned lowDetailPoints = 8;
+
+	// the shape at the current Detail
+	Detail m_detail = Detail::Full;
+	bool m_useShader;
+	const unsigned m_fullObjectPoints;
 	const unsigned m_maxObjects;
-	const unsigned m_ObjectPoints;
-	const unsigned m_verticesMultiplier;
+	unsigned m_ObjectPoints;
+	unsigned m_verticesMultiplier;
+	unsigned m_objectVertices;
 	const double PI = 3.14159265358979;
 
 	unsigned m_totalExpectedVertices;
@@ -31,45 +65,79 @@ class Buffer
 	sf::VertexBuffer m_VertexBuffer;
 	std::vector<sf::Vertex> m_vertices;
 	std::vector<unsigned> m_verticesIndexes;
+	std::vector<sf::Vector2f> m_shape; // the vertex positions of an object with a radius of 1 centred on (0, 0)
+
+	// per object
+	std::vector<Instance> m_instances;
+	std::vector<uint8_t> m_changed; // the Instance has changed since its vertices were built
+	std::vector<uint8_t> m_placed;  // setShape() was called on it since the last arrange()
+
+	// the objects being drawn in the order their vertices are in, and per object where it is in that order
+	static constexpr unsigned notDrawn = UINT32_MAX;
+	std::vector<unsigned> m_drawOrder;
+	std::vector<unsigned> m_drawPosition;
+
+	// per draw position, whether its vertices need building or uploading
+	std::vector<uint8_t> m_dirty;
+
+	// clean objects in between two dirty ones that are uploaded anyway, so the runs either side share one upload
+	static constexpr unsigned mergeGap = 8;
 
 	// variable used for keeping track of all of the allocations issued and recived
 	unsigned m_allocationsIssued = 0;
 
+	// what the last update() sent to the GPU
+	size_t m_bytesUploaded = 0;
+	unsigned m_uploads = 0;
+
 
 public:
-	// constructor and detructor
-	explicit Buffer(unsigned maxObjects, unsigned objectPoints, sf::VertexBuffer::Usage usage = sf::VertexBuffer::Stream);
+	// constructor and detructor, shadedCircles is ignored when the shader can't be used on this machine
+	explicit Buffer(unsigned maxObjects, unsigned objectPoints, sf::VertexBuffer::Usage usage = sf::VertexBuffer::Stream,
+	                bool shadedCircles = false);
 	~Buffer() = default;
 
 	[[nodiscard]] Allocations add(sf::Vector2f position = {0, 0}, float radius = 0.0, sf::Color color = { 0, 0, 0 });
 
-	std::vector<sf::Vertex>* getVertices() { return &m_vertices; }
+	const std::vector<sf::Vertex>* getVertices() const { return &m_vertices; }
 	sf::VertexBuffer* getBuffer() { return &m_VertexBuffer; }
 
-	void remove(const Allocations* object);
-	void render(sf::RenderTarget* renderTarget) const;
+	[[nodiscard]] unsigned getMaxObjects() const { return m_maxObjects; }
+	[[nodiscard]] unsigned getDrawnCount() const { return static_cast<unsigned>(m_drawOrder.size()); }
+	[[nodiscard]] bool usesShadedCircles() const { return m_shadedCircles; }
+	[[nodiscard]] size_t getBytesUploaded() const { return m_bytesUploaded; }
+	[[nodiscard]] unsigned getUploadCount() const { return m_uploads; }
+
+	// rebuilds every object drawn when the detail changes
+	void setDetail(Detail detail);
+	[[nodiscard]] Detail getDetail() const { return m_detail; }
+
+	void render(sf::RenderTarget* renderTarget, sf::RenderStates states = sf::RenderStates(sf::BlendAdd)) const;
+
+	// packs the objects placed since the last call at the front of the drawing order and drops everything else
+	void arrange();
+	// rebuilds the vertices of the dirty draw positions in [firstPosition, lastPosition), the ranges can be split
+	// between threads
+	void expand(unsigned firstPosition, unsigned lastPosition);
+	// expands anything still dirty and uploads it
 	void update();
 
-	// allocation processing
-	void setVertexPositions(const Allocations& allocations, sf::Vector2f deltaPosition);
-	void scaleObject(const Allocations& allocations, sf::Vector2f centerPoint, float scaleFactor);
+	// allocation processing, setShape() and setColor() are safe to call from several threads as long as the
+	// allocations differ. setShape() also marks the object to be drawn
+	void setShape(const Allocations& allocations, sf::Vector2f position, float radius);
 	void setColor(const Allocations& allocations, sf::Color newColor);
 
 private:
-	Allocations handleOnePointPrimitive(sf::Vector2f position, sf::Color color);
-	Allocations handleFourPointPrimitive(sf::Vector2f position, sf::Color color, float size);
-	Allocations handleThreePointPrimitive(sf::Vector2f position, sf::Color color, float size);
-
-	void addToVertexVector(Allocations& object, sf::Color color, const std::vector<sf::Vertex>& vertices);
 	void overflowManagement() const;
+	bool loadCircleShader();
+	void setShapePoints(unsigned objectPoints, bool useShader);
 
+	[[nodiscard]] std::vector<sf::Vertex> createShape(sf::Vector2f position, float radius) const;
 	[[nodiscard]] std::vector<sf::Vertex> createTriangleVertices(float radius, sf::Vector2f position) const;
 	[[nodiscard]] std::vector<sf::Vertex> createSquare(sf::Vector2f position, float size) const;
 	[[nodiscard]] std::vector<sf::Vertex> createTriangleAroundPoint(sf::Vector2f position, float size) const;
 	[[nodiscard]] sf::Vector2f idxToCoords(unsigned idx, float radius) const;
-	[[nodiscard]] unsigned scaleIndex(unsigned index, bool scaleUp) const;
 	[[nodiscard]] static sf::PrimitiveType getPrimitiveType(unsigned objectPoints);
 	[[nodiscard]] static unsigned getMultiplier(unsigned objectPoints);
 	[[nodiscard]] unsigned getNextIndex();
 };
-
@@ -1,55 +1,112 @@
 #include "Buffer.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <numeric> // needed for iota()
 
 
+namespace
+{
+	// the quads carry their corner as a texture coordinate, (-1, -1) .. (1, 1), anything further than 1 from the
+	// centre is outside the circle
+	const char* circleShaderSource = R"(
+		void main()
+		{
+			vec2 corner = gl_TexCoord[0].xy;
+			if (dot(corner, corner) > 1.0)
+				discard;
+
+			gl_FragColor = gl_Color;
+		}
+	)";
+
+	// values of Buffer::m_dirty
+	constexpr uint8_t clean = 0;
+	constexpr uint8_t changed = 1;  // the vertices at this draw position have to be built
+	constexpr uint8_t expanded = 2; // the vertices are built but not uploaded
+}
 
-Buffer::Buffer(const unsigned maxObjects, const unsigned objectPoints, const sf::VertexBuffer::Usage usage)
-	: m_maxObjects(maxObjects), m_ObjectPoints(objectPoints), m_verticesMultiplier(getMultiplier(objectPoints))
+
+Buffer::Buffer(const unsigned maxObjects, const unsigned objectPoints, const sf::VertexBuffer::Usage usage, const bool shadedCircles)
+	: m_shadedCircles(shadedCircles && loadCircleShader()), m_useShader(m_shadedCircles), m_fullObjectPoints(objectPoints),
+	m_maxObjects(maxObjects), m_ObjectPoints(m_shadedCircles ? 4 : objectPoints),
+	m_verticesMultiplier(getMultiplier(m_ObjectPoints)), m_objectVertices(m_ObjectPoints * m_verticesMultiplier)
 {
 	// the total expected vertecies (m_maxObjects * m_ObjectPoints) is multiplied by three as we add a point every 3
 	// indexes to represent the circle center. vertices
-	m_totalExpectedVertices = m_maxObjects * m_ObjectPoints * m_verticesMultiplier;
+	m_totalExpectedVertices = m_maxObjects * m_objectVertices;
 
 	// preparing containers for oncoming objects
 	m_vertices.resize(m_totalExpectedVertices, sf::Vertex());
 
-	// vertices indexes are relative to the actual Allocations, meaning 1 index will hold info for (objectPoints * 3) Vertices
+	// the indexes are of objects, 1 index will hold info for (objectPoints * 3) Vertices
 	m_verticesIndexes = std::vector<unsigned>(m_maxObjects);
 	std::iota(m_verticesIndexes.begin(), m_verticesIndexes.end(), 0);
 
+	// nothing is drawn until it is placed
+	m_instances.resize(m_maxObjects);
+	m_changed.resize(m_maxObjects, 1);
+	m_placed.resize(m_maxObjects, 0);
+	m_drawOrder.reserve(m_maxObjects);
+	m_drawPosition.resize(m_maxObjects, notDrawn);
+	m_dirty.resize(m_maxObjects, clean);
+
 
-	m_VertexBuffer = sf::VertexBuffer(getPrimitiveType(objectPoints), usage);
+	m_VertexBuffer = sf::VertexBuffer(getPrimitiveType(m_ObjectPoints), usage);
 	m_VertexBuffer.create(m_totalExpectedVertices);
+
+	setShapePoints(m_ObjectPoints, m_useShader);
 }
 
-Allocations Buffer::handleOnePointPrimitive(const sf::Vector2f position, const sf::Color color)
+
+void Buffer::setShapePoints(const unsigned objectPoints, const bool useShader)
 {
-	const unsigned index = getNextIndex();
-	m_vertices[index].position = position;
-	m_vertices[index].color = color;
-	return Allocations{ {index} };
+	m_ObjectPoints = objectPoints;
+	m_useShader = useShader;
+	m_verticesMultiplier = getMultiplier(objectPoints);
+	m_objectVertices = objectPoints * m_verticesMultiplier;
+	m_VertexBuffer.setPrimitiveType(getPrimitiveType(objectPoints));
+
+	// every shape is a scaled copy of the one with a radius of 1 around (0, 0)
+	m_shape.clear();
+	for (const sf::Vertex& vertex : createShape({ 0, 0 }, 1.f))
+		m_shape.push_back(vertex.position);
 }
 
 
-Allocations Buffer::handleThreePointPrimitive(const sf::Vector2f position, const sf::Color color, const float size)
+void Buffer::setDetail(const Detail detail)
 {
-	const std::vector<sf::Vertex> triangle = createTriangleAroundPoint(position, size);
+	if (detail == m_detail)
+		return;
 
-	Allocations object;
-	addToVertexVector(object, color, triangle);
-	return object;
+	m_detail = detail;
+
+	unsigned objectPoints = m_fullObjectPoints;
+	if (detail == Detail::Point)
+		objectPoints = 1;
+	else if (m_shadedCircles)
+		objectPoints = 4;
+	else if (detail == Detail::Low)
+		objectPoints = std::min(lowDetailPoints, m_fullObjectPoints);
+
+	// the shaded quad is the same at low and full detail
+	const bool useShader = m_shadedCircles && detail != Detail::Point;
+	if (objectPoints == m_ObjectPoints && useShader == m_useShader)
+		return;
+
+	setShapePoints(objectPoints, useShader);
+
+	// everything drawn is in the wrong shape now
+	std::fill(m_dirty.begin(), m_dirty.begin() + getDrawnCount(), changed);
 }
 
 
-Allocations Buffer::handleFourPointPrimitive(const sf::Vector2f position, const sf::Color color, const float size)
+bool Buffer::loadCircleShader()
 {
-	const std::vector<sf::Vertex> rectangle = createSquare(position, size);
+	if (!sf::Shader::isAvailable())
+		return false;
 
-	// creating the object which will describe the Vertecies
-	Allocations object;
-	addToVertexVector(object, color, rectangle);
-	return object;
+	return m_circleShader.loadFromMemory(circleShaderSource, sf::Shader::Fragment);
 }
 
 
@@ -68,100 +125,187 @@ Allocations Buffer::add(const sf::Vector2f position, const float radius, const s
 	overflowManagement();
 	m_allocationsIssued++;
 
-	// if there is only one Vertex describing an object we can take a shortcut
-	if (m_ObjectPoints == 1)
-	{
-		return handleOnePointPrimitive(position, color);
-	}
+	const unsigned object = getNextIndex();
+	m_instances[object] = { position, radius, color };
+	m_changed[object] = 1;
+	return Allocations{ object, 1 };
+}
 
-	else if (m_ObjectPoints == 2)
-	{
-		// TODO
-	}
 
-	else if (m_ObjectPoints == 3)
+void Buffer::render(sf::RenderTarget* renderTarget, sf::RenderStates states) const
+{
+	if (m_useShader)
+		states.shader = &m_circleShader;
+
+	renderTarget->draw(m_VertexBuffer, 0, getDrawnCount() * m_objectVertices, states);
+}
+
+
+void Buffer::arrange()
+{
+	// dropping what wasn't placed, the last object drawn takes its place
+	unsigned position = 0;
+	while (position < getDrawnCount())
 	{
-		return handleThreePointPrimitive(position, color, radius);
+		const unsigned object = m_drawOrder[position];
+		if (m_placed[object])
+		{
+			position++;
+			continue;
+		}
+
+		const unsigned last = m_drawOrder.back();
+		m_drawOrder[position] = last;
+		m_drawPosition[last] = position;
+		m_drawPosition[object] = notDrawn;
+		m_drawOrder.pop_back();
+
+		// its vertices have to be rebuilt where it is now, if it was the one dropped this does nothing
+		m_changed[last] = 1;
 	}
 
-	else if (m_ObjectPoints == 4)
+	// the newly placed objects go on the end
+	for (unsigned object{ 0 }; object < m_maxObjects; object++)
 	{
-		return handleFourPointPrimitive(position, color, radius);
+		if (!m_placed[object])
+			continue;
+
+		m_placed[object] = 0;
+		if (m_drawPosition[object] != notDrawn)
+			continue;
+
+		m_drawPosition[object] = getDrawnCount();
+		m_drawOrder.push_back(object);
+		m_changed[object] = 1;
 	}
 
-	// Create the vertex data for the circle
-	const std::vector<sf::Vertex> triangles = createTriangleVertices(radius, position);
+	for (position = 0; position < getDrawnCount(); position++)
+	{
+		const unsigned object = m_drawOrder[position];
+		if (!m_changed[object])
+			continue;
 
-	// creating the object which will describe the Vertecies
-	Allocations object;
-	addToVertexVector(object, color, triangles);
-	return object;
+		m_changed[object] = 0;
+		m_dirty[position] = changed;
+	}
 }
 
-void Buffer::addToVertexVector(Allocations& object, const sf::Color color, const std::vector<sf::Vertex>& vertices)
-{
-	const unsigned startIndex = getNextIndex();
-	object.indexes.resize(vertices.size());
 
-	for (unsigned i = 0; i < vertices.size(); i++)
+void Buffer::expand(const unsigned firstPosition, const unsigned lastPosition)
+{
+	for (unsigned position{ firstPosition }; position < lastPosition; position++)
 	{
-		m_vertices[startIndex + i].position = vertices[i].position;
-		m_vertices[startIndex + i].color = color;
-		object.indexes[i] = startIndex + i;
+		if (m_dirty[position] != changed)
+			continue;
+
+		const Instance& instance = m_instances[m_drawOrder[position]];
+		sf::Vertex* vertices = m_vertices.data() + position * m_objectVertices;
+		for (unsigned i = 0; i < m_objectVertices; i++)
+		{
+			// built from scratch every time rather than moved, so the vertices can never drift away from the position
+			vertices[i].position = instance.position + m_shape[i] * instance.radius;
+			vertices[i].color = instance.color;
+			vertices[i].texCoords = m_shape[i];
+		}
+		m_dirty[position] = expanded;
 	}
 }
 
 
-void Buffer::remove(const Allocations* object)
+void Buffer::update()
 {
-	const unsigned objectMinIndex = object->indexes[0];
+	const unsigned drawn = getDrawnCount();
+	expand(0, drawn);
 
-	// freeing up a new index to be used
-	m_verticesIndexes.push_back(scaleIndex(objectMinIndex, false));
+	m_bytesUploaded = 0;
+	m_uploads = 0;
 
-	// "removing" the indexes from the Buffer by making it invisible
-	for (const unsigned index : object->indexes)
+	unsigned position = 0;
+	while (position < drawn)
 	{
-		m_vertices[index].color = sf::Color(0, 0, 0, 0);
+		if (m_dirty[position] == clean)
+		{
+			position++;
+			continue;
+		}
+
+		// extending the run until there are more than mergeGap clean positions in a row
+		unsigned runEnd = position + 1;
+		unsigned cleanRun = 0;
+		for (unsigned i{ runEnd }; i < drawn && cleanRun <= mergeGap; i++)
+		{
+			if (m_dirty[i] != clean)
+			{
+				runEnd = i + 1;
+				cleanRun = 0;
+			}
+			else
+				cleanRun++;
+		}
+
+		const unsigned offset = position * m_objectVertices;
+		const unsigned count = (runEnd - position) * m_objectVertices;
+		m_VertexBuffer.update(m_vertices.data() + offset, count, offset);
+		std::fill(m_dirty.begin() + position, m_dirty.begin() + runEnd, clean);
+
+		m_bytesUploaded += count * sizeof(sf::Vertex);
+		m_uploads++;
+		position = runEnd;
 	}
-
-	m_allocationsIssued--;
 }
 
 
-void Buffer::render(sf::RenderTarget* renderTarget) const
+void Buffer::setShape(const Allocations& allocations, const sf::Vector2f position, const float radius)
 {
-	renderTarget->draw(m_VertexBuffer, sf::BlendAdd);
-}
+	for (unsigned object{ allocations.first }; object < allocations.end(); object++)
+	{
+		m_placed[object] = 1;
 
+		Instance& instance = m_instances[object];
+		if (instance.position == position && instance.radius == radius)
+			continue;
 
-void Buffer::update()
-{
-	m_VertexBuffer.update(m_vertices.data(), m_vertices.size(), 0);
+		instance.position = position;
+		instance.radius = radius;
+		m_changed[object] = 1;
+	}
 }
 
 
-void Buffer::setVertexPositions(const Allocations& allocations, const sf::Vector2f deltaPosition)
+void Buffer::setColor(const Allocations& allocations, const sf::Color newColor)
 {
-	for (const unsigned index : allocations.indexes)
+	for (unsigned object{ allocations.first }; object < allocations.end(); object++)
 	{
-		m_vertices[index].position += deltaPosition;
+		if (m_instances[object].color == newColor)
+			continue;
+
+		m_instances[object].color = newColor;
+		m_changed[object] = 1;
 	}
 }
 
 
-void Buffer::scaleObject(const Allocations& allocations, const sf::Vector2f centerPoint, const float scaleFactor)
+std::vector<sf::Vertex> Buffer::createShape(const sf::Vector2f position, const float radius) const
 {
-	
-}
+	// if there is only one Vertex describing an object we can take a shortcut
+	if (m_ObjectPoints == 1)
+		return { sf::Vertex(position) };
 
+	// the quad the circle shader cuts the circle out of
+	if (m_useShader)
+		return createSquare(position, radius * 2.f);
 
-void Buffer::setColor(const Allocations& allocations, const sf::Color newColor)
-{
-	for (const unsigned index : allocations.indexes)
-	{
-		m_vertices[index].color = newColor;
-	}
+	// a line across the object, drawn with sf::Lines
+	if (m_ObjectPoints == 2)
+		return { sf::Vertex(position - sf::Vector2f{ radius, 0 }), sf::Vertex(position + sf::Vector2f{ radius, 0 }) };
+
+	if (m_ObjectPoints == 3)
+		return createTriangleAroundPoint(position, radius);
+
+	if (m_ObjectPoints == 4)
+		return createSquare(position, radius);
+
+	return createTriangleVertices(radius, position);
 }
 
 
@@ -231,7 +375,7 @@ std::vector<sf::Vertex> Buffer::createTriangleAroundPoint(const sf::Vector2f pos
 
 sf::Vector2f Buffer::idxToCoords(const unsigned idx, const float radius) const
 {
-	static const auto angleIncrement = static_cast <float>(2 * PI / m_ObjectPoints);
+	const auto angleIncrement = static_cast <float>(2 * PI / m_ObjectPoints);
 
 	const float angle = static_cast<float>(idx) * angleIncrement;
 	const float cosAngle = std::cos(angle);
@@ -244,16 +388,6 @@ sf::Vector2f Buffer::idxToCoords(const unsigned idx, const float radius) const
 }
 
 
-unsigned Buffer::scaleIndex(const unsigned index, const bool scaleUp) const
-{
-	// false = scale down, true = scale up.
-	// this function is used to convert indexes from the m_vertices and m_verticesIndexes containers
-	const unsigned scaleFactor = m_ObjectPoints * m_verticesMultiplier;
-	if (scaleUp)
-		return index * scaleFactor;
-	return index / scaleFactor;
-}
-
 sf::PrimitiveType Buffer::getPrimitiveType(const unsigned objectPoints)
 {
 	if (objectPoints == 1)
@@ -277,7 +411,7 @@ unsigned Buffer::getMultiplier(const unsigned objectPoints)
 
 unsigned Buffer::getNextIndex()
 {
-	const unsigned index = scaleIndex(m_verticesIndexes.back(), true);
+	const unsigned index = m_verticesIndexes.back();
 	m_verticesIndexes.pop_back();
 	return index;
 }
@@ -0,0 +1,58 @@
+#include "simulation/World.hpp"
+
+#include <string>
+
+/*
+ * headless entry point, runs the world for a fixed number of ticks with no window and exits
+ * usage: Biological-life-headless [ticks] [trace export frequency] [seed] [threads]
+ * when a trace export frequency is given a Chrome trace of the last few thousand ticks is written to trace.json
+ * the same seed always produces the same run
+ */
+
+
+int main(const int argc, char* argv[])
+{
+	uint64_t ticks = 10'000;
+	uint64_t traceFrequency = 0;
+	uint64_t seed = static_cast<uint64_t>(time(nullptr));
+	uint64_t threads = 0;
+
+	const bool valid = argc <= 5 &&
+		(argc <= 1 || parseArgument(argv[1], ticks)) &&
+		(argc <= 2 || parseArgument(argv[2], traceFrequency, std::numeric_limits<unsigned>::max())) &&
+		(argc <= 3 || parseArgument(argv[3], seed)) &&
+		(argc <= 4 || parseArgument(argv[4], threads, ThreadPool::maxThreads));
+	if (!valid)
+	{
+		std::cerr << "usage: Biological-life-headless [ticks] [trace export frequency] [seed] [threads]" << "\n";
+		std::cerr << "every argument is a whole number, threads is at most " << ThreadPool::maxThreads << " (0 uses every hardware thread)" << "\n";
+		return 1;
+	}
+
+	// initilising random
+	Random::setSeed(seed);
+
+	Settings settings = defaultSettings();
+	settings.threadCount = static_cast<unsigned>(threads);
+
+	World world(settings);
+	world.setTraceExport(static_cast<unsigned>(traceFrequency));
+
+	const auto start = std::chrono::high_resolution_clock::now();
+	world.runTicks(ticks);
+	const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+	std::cout << "ran " << ticks << " ticks in " << roundToNearestN(elapsed.count(), 2) << "s ("
+		<< roundToNearestN(static_cast<double>(ticks) / elapsed.count(), 1) << " ticks/s)" << "\n";
+	std::cout << "seed : " << seed << " checksum: " << world.computeChecksum() << "\n";
+	std::cout << "alive: " << world.getCellCount() << " cells, " << world.getPlantCount() << " plants" << "\n";
+	world.printGridOverflow();
+
+	for (unsigned i{ 0 }; i < static_cast<unsigned>(Phase::Count); i++)
+	{
+		const auto phase = static_cast<Phase>(i);
+		if (world.getProfiler().getCount(phase) == 0)
+			continue;
+		std::cout << "  " << phaseName(phase) << ": " << roundToNearestN(world.getProfiler().getTotalMs(phase), 1) << " ms" << "\n";
+	}
+}
@@ -1,4 +1,4 @@
-#include "Simulation/Simulation.hpp"
+#include "simulation/Simulation.hpp"
 
 /*
  * KEYBINDS
@@ -7,13 +7,17 @@
  * shift + b - body
  * shift + d - velocities
  * shift + z - zone
+ *
+ * m          - switch between a fixed number of ticks per frame and filling the frame budget
+ * up / down  - double / halve the ticks run per frame
+ * ctrl + p   - write a Chrome trace of the recent tick phases to trace.json
  */
 
 
 int main()
 {
-	// initilising random
-	std::srand(static_cast<unsigned>(time(nullptr)));
+	// initilising random, the seed is written into every save so a run can be reproduced
+	Random::setSeed(static_cast<uint64_t>(time(nullptr)));
 
 	// the color of the simulation is randomly determined by these colors:
 	constexpr unsigned colors = 2;
@@ -22,30 +26,9 @@ int main()
 		{40, 29, 58}
 	};
 
-	const Settings settings(
-		1650,
-		3'000,
-		500,
-
-		true,
-		false,
-
-		2500,
-
-		{ 1800, 1000 },
-		0.100f,
-		2240,
-		windowColors[randint(0, colors - 1)],
-		"Biologial Evolution Simulation",
-
-		20,
-		1'000,
-
-		"data.json",
-		{ 25 , 15 } // originally 30, 20
-	);
+	const Settings settings = defaultSettings(windowColors[randint(Random::global(), 0, colors - 1)]);
 
 	Simulation simulation(settings);
 
 	simulation.run();
-}
\ No newline at end of file
+}
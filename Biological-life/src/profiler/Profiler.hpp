@@ -0,0 +1,176 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+	Profiler
+
+	scoped timers around every phase of a tick. Every measurement is written into a fixed size ring buffer so the
+	cost of a sample is two clock reads and a store, which is cheap enough to leave on all the time. The ring can be
+	written out as a Chrome / Perfetto trace (chrome://tracing or ui.perfetto.dev) and running totals are kept per
+	phase for the statistics print out and the benchmarks.
+*/
+
+
+enum class Phase : uint8_t
+{
+	PrepGrid,
+	AddRemoveCells,
+	AddRemovePlants,
+	UpdatePlants,
+	PrepareCells,
+	CellInference,
+	UpdateCells,
+	OverflowProtection,
+	GenerateVertices,
+	BufferUpdate,
+	Count
+};
+
+
+inline const char* phaseName(const Phase phase)
+{
+	static constexpr std::array<const char*, static_cast<size_t>(Phase::Count)> names = {
+		"prepGrid",
+		"addAndRemoveEntities (cells)",
+		"addAndRemoveEntities (plants)",
+		"updatePlants",
+		"prepareCells",
+		"cellInference",
+		"updateCells",
+		"overflowProtection",
+		"generateVertices",
+		"Buffer::update"
+	};
+	return names[static_cast<size_t>(phase)];
+}
+
+
+class Profiler
+{
+	using clock = std::chrono::steady_clock;
+
+	struct Sample
+	{
+		int64_t start = 0;    // nanoseconds since the profiler was created
+		int64_t duration = 0; // nanoseconds
+		uint64_t tick = 0;
+		Phase phase = Phase::Count;
+	};
+
+	static constexpr size_t phaseCount = static_cast<size_t>(Phase::Count);
+
+	std::vector<Sample> m_samples;
+	size_t m_next = 0;
+	bool m_wrapped = false;
+
+	std::array<int64_t, phaseCount> m_totals{};
+	std::array<uint64_t, phaseCount> m_counts{};
+
+	const clock::time_point m_origin = clock::now();
+	uint64_t m_currentTick = 0;
+
+
+public:
+	// the default capacity holds roughly the last 4000 ticks worth of samples
+	explicit Profiler(const size_t capacity = 4'096 * phaseCount) : m_samples(capacity) {}
+
+	class ScopedTimer
+	{
+		Profiler& m_profiler;
+		const Phase m_phase;
+		const clock::time_point m_start = clock::now();
+
+	public:
+		ScopedTimer(Profiler& profiler, const Phase phase) : m_profiler(profiler), m_phase(phase) {}
+		~ScopedTimer() { m_profiler.record(m_phase, m_start, clock::now()); }
+
+		ScopedTimer(const ScopedTimer&) = delete;
+		ScopedTimer& operator=(const ScopedTimer&) = delete;
+	};
+
+	// times a single call, used to wrap each phase of the tick
+	template<class Function>
+	void measure(const Phase phase, Function&& function)
+	{
+		ScopedTimer timer(*this, phase);
+		function();
+	}
+
+	void setTick(const uint64_t tick) { m_currentTick = tick; }
+
+	void record(const Phase phase, const clock::time_point start, const clock::time_point end)
+	{
+		Sample& sample = m_samples[m_next];
+		sample.start = std::chrono::duration_cast<std::chrono::nanoseconds>(start - m_origin).count();
+		sample.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+		sample.tick = m_currentTick;
+		sample.phase = phase;
+
+		if (++m_next == m_samples.size())
+		{
+			m_next = 0;
+			m_wrapped = true;
+		}
+
+		m_totals[static_cast<size_t>(phase)] += sample.duration;
+		m_counts[static_cast<size_t>(phase)]++;
+	}
+
+	// total time in milliseconds spent in a phase since the last resetTotals()
+	[[nodiscard]] double getTotalMs(const Phase phase) const
+	{
+		return static_cast<double>(m_totals[static_cast<size_t>(phase)]) / 1'000'000.0;
+	}
+
+	[[nodiscard]] uint64_t getCount(const Phase phase) const { return m_counts[static_cast<size_t>(phase)]; }
+
+	void resetTotals()
+	{
+		m_totals.fill(0);
+		m_counts.fill(0);
+	}
+
+
+	// writes every sample in the ring buffer as a Chrome trace event file
+	bool exportChromeTrace(const std::string& fileName) const
+	{
+		nlohmann::json events = nlohmann::json::array();
+
+		const size_t count = m_wrapped ? m_samples.size() : m_next;
+		const size_t first = m_wrapped ? m_next : 0;
+
+		for (size_t i{ 0 }; i < count; i++)
+		{
+			const Sample& sample = m_samples[(first + i) % m_samples.size()];
+			events.push_back({
+				{"name", phaseName(sample.phase)},
+				{"cat",  "tick"},
+				{"ph",   "X"},
+				{"ts",   static_cast<double>(sample.start) / 1'000.0},   // microseconds
+				{"dur",  static_cast<double>(sample.duration) / 1'000.0},
+				{"pid",  0},
+				{"tid",  0},
+				{"args", {{"tick", sample.tick}}}
+			});
+		}
+
+		std::ofstream ofs(fileName);
+		if (!ofs.is_open())
+		{
+			std::cerr << "[Profiler]: failed to open " << fileName << "\n";
+			return false;
+		}
+
+		ofs << nlohmann::json{ {"traceEvents", events}, {"displayTimeUnit", "ms"} }.dump();
+		return true;
+	}
+};
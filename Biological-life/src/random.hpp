@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+
+/*
+	Random
+
+	a counter-based generator built on Widynski's "Squares" RNG. A generator is nothing more than a key and a counter,
+	the key is derived from (seed, entity slot, tick, stream) so every entity gets its own independent sequence each
+	tick. This means a random draw gives the same result no matter what order the entities are processed in or which
+	thread processes them, and a whole run can be reproduced from its seed.
+
+	Streams keep the different uses of randomness for the same entity on the same tick apart, sub is used when the
+	same stream has to be drawn from more than once in a tick (e.g. the passes of overflowCheckEntities)
+*/
+
+
+class Random
+{
+	uint64_t m_key;
+	uint64_t m_counter = 0;
+
+	inline static uint64_t s_seed = 0x9E3779B97F4A7C15ull;
+	inline static uint64_t s_tick = 0;
+
+
+public:
+	enum Stream : uint32_t
+	{
+		Global,
+		CellSpawn,
+		PlantSpawn,
+		CellReproduce,
+		PlantReproduce,
+		PlantUpdate,
+		Uncertainty,
+		OverflowCells,
+		OverflowPlants
+	};
+
+	explicit Random(const uint64_t key) : m_key(key | 1) {}
+
+	// the generator for one entity slot on the current tick
+	static Random forEntity(const uint32_t slot, const Stream stream, const uint32_t sub = 0)
+	{
+		uint64_t key = mix(s_seed);
+		key = mix(key ^ ((static_cast<uint64_t>(slot) << 32) | stream));
+		key = mix(key ^ s_tick);
+		key = mix(key ^ sub);
+		return Random(key);
+	}
+
+	// a single sequence keyed only by the seed, for code that runs once outside of the tick (window color etc)
+	static Random& global()
+	{
+		static Random random(mix(s_seed ^ Global));
+		return random;
+	}
+
+	static void setSeed(const uint64_t seed)
+	{
+		s_seed = seed;
+		s_tick = 0;
+		global() = Random(mix(s_seed ^ Global));
+	}
+	static void setTick(const uint64_t tick) { s_tick = tick; }
+	[[nodiscard]] static uint64_t getSeed() { return s_seed; }
+
+
+	uint32_t next() { return squares32(m_counter++, m_key); }
+
+	// [0, 1)
+	float nextFloat() { return static_cast<float>(next() >> 8) * (1.f / 16'777'216.f); }
+
+	// [start, end)
+	int nextInt(int start, int end)
+	{
+		if (end < start)
+			std::swap(start, end);
+		if (end == start)
+			return start;
+
+		const auto range = static_cast<uint32_t>(end - start);
+		return start + static_cast<int>(next() % range);
+	}
+
+
+private:
+	static uint32_t squares32(const uint64_t ctr, const uint64_t key)
+	{
+		uint64_t x = ctr * key;
+		const uint64_t y = x;
+		const uint64_t z = y + key;
+
+		x = x * x + y; x = (x >> 32) | (x << 32);
+		x = x * x + z; x = (x >> 32) | (x << 32);
+		x = x * x + y; x = (x >> 32) | (x << 32);
+		return static_cast<uint32_t>((x * x + z) >> 32);
+	}
+
+	// splitmix64 finaliser, used to turn the (seed, slot, tick, stream) tuple into a well mixed key
+	static uint64_t mix(uint64_t value)
+	{
+		value += 0x9E3779B97F4A7C15ull;
+		value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+		value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+		return value ^ (value >> 31);
+	}
+};
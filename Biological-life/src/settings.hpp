@@ -2,6 +2,26 @@
 
 #include <SFML/Graphics.hpp>
 
+#include <cstdint>
+
+
+// how the spatial grid is stored, see SpatialHashGrid and CountingSortGrid
+enum class GridBackend : uint8_t
+{
+	Fixed,        // fixed capacity buckets, rebuilt one entity at a time
+	CountingSort  // one contiguous array rebuilt with a parallel counting sort
+};
+
+
+// how the networks work out their sigmoid, see simd/activation.hpp
+enum class Activation : uint8_t
+{
+	Exact, // std::exp, the same results as runs made before this existed
+	Fast,  // polynomial exp2 approximation, within ~1e-7
+	Tanh   // rational tanh approximation, within ~5e-5
+};
+
+
 struct Settings
 {
 	// organic simulation settings
@@ -12,8 +32,6 @@ struct Settings
 	const bool autoExtinctionReset;
 	const bool cellCroudingDeath;
 
-	const unsigned alignmentFreq;
-
 
 	// graphical settings
 	sf::Vector2f windowSize;
@@ -29,11 +47,51 @@ struct Settings
 	const std::string fileReadWriteName;
 	const sf::Vector2u hashGridCells;
 
+	// threads used for the parallel tick phases, including the main thread (0 = every hardware thread)
+	unsigned threadCount = 0;
+
+	GridBackend gridBackend = GridBackend::Fixed;
+
+	// when false the fixed grid drops anything past a full cell like it always used to. Ignored with the counting sort
+	// grid, it has no per cell capacity so it is always lossless
+	bool losslessGrid = true;
+
+	// run every cell's network in one NetworkBatch after perception, when false each cell runs its own
+	bool batchedInference = true;
+
+	Activation activation = Activation::Exact;
+
 	static constexpr unsigned maxCells = 10'000;
 	static constexpr unsigned maxPlants = 4'000;
 };
 
 
+// the settings the simulation is normally run with, shared by the windowed and headless executables
+inline Settings defaultSettings(const sf::Color windowColor = { 20, 30, 50 })
+{
+	return {
+		1650,
+		3'000,
+		500,
+
+		true,
+		false,
+
+		{ 1800, 1000 },
+		0.100f,
+		2240,
+		windowColor,
+		"Biologial Evolution Simulation",
+
+		20,
+		1'000,
+
+		"data.json",
+		{ 25 , 15 } // originally 30, 20
+	};
+}
+
+
 struct CellSettings
 {
 	static constexpr float visualRadius = 82.f;
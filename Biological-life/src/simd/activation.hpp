@@ -0,0 +1,197 @@
+#pragma once
+
+#include "../settings.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define ACTIVATION_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define ACTIVATION_SSE2
+#endif
+
+/*
+	activation
+
+	the sigmoid the networks run every hidden and output neuron through, in three flavours picked with Activation:
+
+	Exact - 1 / (1 + std::exp(-x)), exactly what the networks have always done, use it to reproduce older runs
+	Fast  - e^-x worked out as 2^(-x * log2(e)), the integer part goes straight into the float's exponent bits and the
+	        fraction is a degree 6 polynomial. Within ~1e-7 of the real sigmoid, about as close as float std::exp gets
+	Tanh  - 0.5 + 0.5 * tanh(x / 2) with tanh as a [7/6] rational approximation, no exp or bit tricks at all, only
+	        multiplies, adds and a divide. Within ~5e-5 of the real sigmoid
+
+	sigmoid(values, count) runs a whole array at once, Fast and Tanh use AVX2 / SSE2 there (whichever the compiler is
+	allowed to emit, same as closestNeighbour) and Exact stays a std::exp loop. The vector paths do the same float
+	operations in the same order as the scalar functions, so a mode gives the same answer whichever path runs it.
+	The benchmark executable's "activation" mode reports the speed and max error of each one.
+*/
+
+
+namespace activation
+{
+	// Fast
+	inline constexpr float negLog2e = -1.44269504f;
+	inline constexpr float exp2Min = -126.f;  // keeps the result a normal float
+	inline constexpr float exp2Max = 126.f;
+	inline constexpr float roundMagic = 12582912.f; // 1.5 * 2^23, adding and taking it away rounds to the nearest integer
+
+	inline constexpr float exp2Poly[7] = { 1.540353e-4f, 1.333355e-3f, 9.618129e-3f, 5.550411e-2f, 2.402265e-1f, 6.931472e-1f, 1.f };
+
+	// Tanh
+	inline constexpr float tanhClamp = 4.97f; // where the approximation reaches 1
+	inline constexpr float tanhNum[4] = { 1.f, 378.f, 17325.f, 135135.f };
+	inline constexpr float tanhDen[4] = { 28.f, 3150.f, 62370.f, 135135.f };
+
+
+	inline float exp2Fast(float x)
+	{
+		x = std::min(std::max(x, exp2Min), exp2Max);
+		const float whole = (x + roundMagic) - roundMagic;
+		const float fraction = x - whole;
+
+		float poly = exp2Poly[0];
+		for (unsigned i{ 1 }; i < 7; i++)
+			poly = poly * fraction + exp2Poly[i];
+
+		const float scale = std::bit_cast<float>((static_cast<int32_t>(whole) + 127) << 23);
+		return poly * scale;
+	}
+
+	inline float tanhRational(float x)
+	{
+		x = std::min(std::max(x, -tanhClamp), tanhClamp);
+		const float x2 = x * x;
+
+		float num = tanhNum[0];
+		float den = tanhDen[0];
+		for (unsigned i{ 1 }; i < 4; i++)
+		{
+			num = num * x2 + tanhNum[i];
+			den = den * x2 + tanhDen[i];
+		}
+
+		return x * num / den;
+	}
+
+
+	inline float sigmoidExact(const float x) { return 1.f / (1.f + std::exp(-x)); }
+	inline float sigmoidFast(const float x)  { return 1.f / (1.f + exp2Fast(x * negLog2e)); }
+	inline float sigmoidTanh(const float x)  { return 0.5f + 0.5f * tanhRational(0.5f * x); }
+
+	template<Activation A>
+	float sigmoid(const float x)
+	{
+		if constexpr (A == Activation::Fast)
+			return sigmoidFast(x);
+		else if constexpr (A == Activation::Tanh)
+			return sigmoidTanh(x);
+		else
+			return sigmoidExact(x);
+	}
+
+
+#if defined(ACTIVATION_AVX2)
+	inline __m256 sigmoidFast(const __m256 value)
+	{
+		const __m256 x = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(value, _mm256_set1_ps(negLog2e)), _mm256_set1_ps(exp2Min)), _mm256_set1_ps(exp2Max));
+		const __m256 whole = _mm256_sub_ps(_mm256_add_ps(x, _mm256_set1_ps(roundMagic)), _mm256_set1_ps(roundMagic));
+		const __m256 fraction = _mm256_sub_ps(x, whole);
+
+		__m256 poly = _mm256_set1_ps(exp2Poly[0]);
+		for (unsigned i{ 1 }; i < 7; i++)
+			poly = _mm256_add_ps(_mm256_mul_ps(poly, fraction), _mm256_set1_ps(exp2Poly[i]));
+
+		const __m256i exponent = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(whole), _mm256_set1_epi32(127)), 23);
+		const __m256 exp = _mm256_mul_ps(poly, _mm256_castsi256_ps(exponent));
+
+		const __m256 one = _mm256_set1_ps(1.f);
+		return _mm256_div_ps(one, _mm256_add_ps(one, exp));
+	}
+
+	inline __m256 sigmoidTanh(const __m256 value)
+	{
+		const __m256 x = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), value), _mm256_set1_ps(-tanhClamp)), _mm256_set1_ps(tanhClamp));
+		const __m256 x2 = _mm256_mul_ps(x, x);
+
+		__m256 num = _mm256_set1_ps(tanhNum[0]);
+		__m256 den = _mm256_set1_ps(tanhDen[0]);
+		for (unsigned i{ 1 }; i < 4; i++)
+		{
+			num = _mm256_add_ps(_mm256_mul_ps(num, x2), _mm256_set1_ps(tanhNum[i]));
+			den = _mm256_add_ps(_mm256_mul_ps(den, x2), _mm256_set1_ps(tanhDen[i]));
+		}
+
+		const __m256 tanh = _mm256_div_ps(_mm256_mul_ps(x, num), den);
+		return _mm256_add_ps(_mm256_set1_ps(0.5f), _mm256_mul_ps(_mm256_set1_ps(0.5f), tanh));
+	}
+
+#elif defined(ACTIVATION_SSE2)
+	inline __m128 sigmoidFast(const __m128 value)
+	{
+		const __m128 x = _mm_min_ps(_mm_max_ps(_mm_mul_ps(value, _mm_set1_ps(negLog2e)), _mm_set1_ps(exp2Min)), _mm_set1_ps(exp2Max));
+		const __m128 whole = _mm_sub_ps(_mm_add_ps(x, _mm_set1_ps(roundMagic)), _mm_set1_ps(roundMagic));
+		const __m128 fraction = _mm_sub_ps(x, whole);
+
+		__m128 poly = _mm_set1_ps(exp2Poly[0]);
+		for (unsigned i{ 1 }; i < 7; i++)
+			poly = _mm_add_ps(_mm_mul_ps(poly, fraction), _mm_set1_ps(exp2Poly[i]));
+
+		const __m128i exponent = _mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(whole), _mm_set1_epi32(127)), 23);
+		const __m128 exp = _mm_mul_ps(poly, _mm_castsi128_ps(exponent));
+
+		const __m128 one = _mm_set1_ps(1.f);
+		return _mm_div_ps(one, _mm_add_ps(one, exp));
+	}
+
+	inline __m128 sigmoidTanh(const __m128 value)
+	{
+		const __m128 x = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_set1_ps(0.5f), value), _mm_set1_ps(-tanhClamp)), _mm_set1_ps(tanhClamp));
+		const __m128 x2 = _mm_mul_ps(x, x);
+
+		__m128 num = _mm_set1_ps(tanhNum[0]);
+		__m128 den = _mm_set1_ps(tanhDen[0]);
+		for (unsigned i{ 1 }; i < 4; i++)
+		{
+			num = _mm_add_ps(_mm_mul_ps(num, x2), _mm_set1_ps(tanhNum[i]));
+			den = _mm_add_ps(_mm_mul_ps(den, x2), _mm_set1_ps(tanhDen[i]));
+		}
+
+		const __m128 tanh = _mm_div_ps(_mm_mul_ps(x, num), den);
+		return _mm_add_ps(_mm_set1_ps(0.5f), _mm_mul_ps(_mm_set1_ps(0.5f), tanh));
+	}
+#endif
+
+
+	// values[i] = sigmoid(values[i])
+	template<Activation A>
+	void sigmoid(float* values, const unsigned count)
+	{
+		unsigned i = 0;
+
+		if constexpr (A != Activation::Exact)
+		{
+#if defined(ACTIVATION_AVX2)
+			for (; i + 8 <= count; i += 8)
+			{
+				const __m256 x = _mm256_loadu_ps(values + i);
+				_mm256_storeu_ps(values + i, A == Activation::Fast ? sigmoidFast(x) : sigmoidTanh(x));
+			}
+#elif defined(ACTIVATION_SSE2)
+			for (; i + 4 <= count; i += 4)
+			{
+				const __m128 x = _mm_loadu_ps(values + i);
+				_mm_storeu_ps(values + i, A == Activation::Fast ? sigmoidFast(x) : sigmoidTanh(x));
+			}
+#endif
+		}
+
+		for (; i < count; i++)
+			values[i] = sigmoid<A>(values[i]);
+	}
+}
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define CLOSEST_NEIGHBOUR_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define CLOSEST_NEIGHBOUR_SSE2
+#endif
+
+/*
+	closestNeighbour
+
+	the inner loop of the neighbour scan every cell runs twice a tick (once for cells, once for plants). Given the
+	packed positions and radii of everything the grid query found it returns the index of the closest one and how
+	many are within visual range, in a single pass.
+
+	AVX2 is used when the compiler is allowed to emit it (/arch:AVX2, -mavx2), otherwise SSE2 which every x64 cpu has,
+	with a plain scalar loop as the fallback. Every path does the same float operations in the same order as the
+	scalar loop and ties go to the lowest index, so the result is bit for bit the same whichever one is compiled in.
+*/
+
+
+// the neighbours of one query laid out one array per field, reused between queries
+struct PackedNeighbours
+{
+	std::vector<float> x{};
+	std::vector<float> y{};
+	std::vector<float> radius{};
+
+	void clear()
+	{
+		x.clear();
+		y.clear();
+		radius.clear();
+	}
+
+	void reserve(const size_t count)
+	{
+		x.reserve(count);
+		y.reserve(count);
+		radius.reserve(count);
+	}
+
+	void add(const sf::Vector2f position, const float entityRadius)
+	{
+		x.push_back(position.x);
+		y.push_back(position.y);
+		radius.push_back(entityRadius);
+	}
+
+	[[nodiscard]] unsigned size() const { return static_cast<unsigned>(x.size()); }
+};
+
+
+struct ClosestNeighbour
+{
+	static constexpr int32_t none = -1;
+
+	int32_t index = none;  // into the packed arrays
+	unsigned inRange = 0;  // neighbours within visual range, not counting anything sitting exactly on position
+};
+
+
+namespace simd
+{
+	// the distance used to rank neighbours, the squared distance between centres minus the squared sum of the radii
+	inline float edgeDistSq(const sf::Vector2f position, const float radius, const float x, const float y, const float otherRadius)
+	{
+		const float dx = x - position.x;
+		const float dy = y - position.y;
+		const float localDiam = radius + otherRadius;
+		return (dx * dx + dy * dy) - (localDiam * localDiam);
+	}
+
+
+	// the scalar loop, also used for the elements left over after the vector loop
+	inline void closestNeighbourScalar(const PackedNeighbours& neighbours, const unsigned first, const sf::Vector2f position,
+	                                   const float radius, const float visualRangeSq, ClosestNeighbour& result, float& closestDistSq)
+	{
+		for (unsigned i{ first }; i < neighbours.size(); i++)
+		{
+			if (neighbours.x[i] == position.x && neighbours.y[i] == position.y)
+				continue;
+
+			const float distSq = edgeDistSq(position, radius, neighbours.x[i], neighbours.y[i], neighbours.radius[i]);
+
+			if (distSq < visualRangeSq) result.inRange++;
+
+			if (distSq < closestDistSq)
+			{
+				result.index = static_cast<int32_t>(i);
+				closestDistSq = distSq;
+			}
+		}
+	}
+
+
+	// picks the closest of the per lane winners, equal distances go to the lowest index like the scalar loop
+	template<unsigned Lanes>
+	void reduceLanes(const float (&laneDist)[Lanes], const int32_t (&laneIndex)[Lanes], ClosestNeighbour& result, float& closestDistSq)
+	{
+		for (unsigned lane{ 0 }; lane < Lanes; lane++)
+		{
+			if (laneIndex[lane] == ClosestNeighbour::none)
+				continue;
+
+			if (laneDist[lane] < closestDistSq || (laneDist[lane] == closestDistSq && laneIndex[lane] < result.index))
+			{
+				closestDistSq = laneDist[lane];
+				result.index = laneIndex[lane];
+			}
+		}
+	}
+}
+
+
+inline ClosestNeighbour closestNeighbour(const PackedNeighbours& neighbours, const sf::Vector2f position, const float radius, const float visualRange)
+{
+	const float visualRangeSq = visualRange * visualRange;
+
+	ClosestNeighbour result;
+	float closestDistSq = visualRangeSq;
+	unsigned i = 0;
+
+#if defined(CLOSEST_NEIGHBOUR_AVX2)
+	constexpr unsigned lanes = 8;
+	const unsigned vectorEnd = neighbours.size() / lanes * lanes;
+
+	const __m256 px = _mm256_set1_ps(position.x);
+	const __m256 py = _mm256_set1_ps(position.y);
+	const __m256 r = _mm256_set1_ps(radius);
+	const __m256 range = _mm256_set1_ps(visualRangeSq);
+
+	__m256 bestDist = range;
+	__m256i bestIndex = _mm256_set1_epi32(ClosestNeighbour::none);
+	__m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256i inRange = _mm256_setzero_si256();
+
+	for (; i < vectorEnd; i += lanes)
+	{
+		const __m256 ox = _mm256_loadu_ps(&neighbours.x[i]);
+		const __m256 oy = _mm256_loadu_ps(&neighbours.y[i]);
+		const __m256 orad = _mm256_loadu_ps(&neighbours.radius[i]);
+
+		const __m256 dx = _mm256_sub_ps(ox, px);
+		const __m256 dy = _mm256_sub_ps(oy, py);
+		const __m256 localDiam = _mm256_add_ps(r, orad);
+		const __m256 distSq = _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(localDiam, localDiam));
+
+		const __m256 samePos = _mm256_and_ps(_mm256_cmp_ps(ox, px, _CMP_EQ_OQ), _mm256_cmp_ps(oy, py, _CMP_EQ_OQ));
+		const __m256 inRangeMask = _mm256_andnot_ps(samePos, _mm256_cmp_ps(distSq, range, _CMP_LT_OQ));
+		const __m256 closerMask = _mm256_andnot_ps(samePos, _mm256_cmp_ps(distSq, bestDist, _CMP_LT_OQ));
+
+		inRange = _mm256_sub_epi32(inRange, _mm256_castps_si256(inRangeMask));
+		bestDist = _mm256_blendv_ps(bestDist, distSq, closerMask);
+		bestIndex = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(bestIndex), _mm256_castsi256_ps(index), closerMask));
+		index = _mm256_add_epi32(index, _mm256_set1_epi32(lanes));
+	}
+
+	float laneDist[lanes];
+	int32_t laneIndex[lanes];
+	int32_t laneInRange[lanes];
+	_mm256_storeu_ps(laneDist, bestDist);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(laneIndex), bestIndex);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(laneInRange), inRange);
+
+	for (const int32_t count : laneInRange)
+		result.inRange += static_cast<unsigned>(count);
+	simd::reduceLanes(laneDist, laneIndex, result, closestDistSq);
+
+#elif defined(CLOSEST_NEIGHBOUR_SSE2)
+	constexpr unsigned lanes = 4;
+	const unsigned vectorEnd = neighbours.size() / lanes * lanes;
+
+	const __m128 px = _mm_set1_ps(position.x);
+	const __m128 py = _mm_set1_ps(position.y);
+	const __m128 r = _mm_set1_ps(radius);
+	const __m128 range = _mm_set1_ps(visualRangeSq);
+
+	__m128 bestDist = range;
+	__m128i bestIndex = _mm_set1_epi32(ClosestNeighbour::none);
+	__m128i index = _mm_setr_epi32(0, 1, 2, 3);
+	__m128i inRange = _mm_setzero_si128();
+
+	for (; i < vectorEnd; i += lanes)
+	{
+		const __m128 ox = _mm_loadu_ps(&neighbours.x[i]);
+		const __m128 oy = _mm_loadu_ps(&neighbours.y[i]);
+		const __m128 orad = _mm_loadu_ps(&neighbours.radius[i]);
+
+		const __m128 dx = _mm_sub_ps(ox, px);
+		const __m128 dy = _mm_sub_ps(oy, py);
+		const __m128 localDiam = _mm_add_ps(r, orad);
+		const __m128 distSq = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(localDiam, localDiam));
+
+		const __m128 samePos = _mm_and_ps(_mm_cmpeq_ps(ox, px), _mm_cmpeq_ps(oy, py));
+		const __m128 inRangeMask = _mm_andnot_ps(samePos, _mm_cmplt_ps(distSq, range));
+		const __m128 closerMask = _mm_andnot_ps(samePos, _mm_cmplt_ps(distSq, bestDist));
+		const __m128i closerMaskI = _mm_castps_si128(closerMask);
+
+		// no blend in SSE2, select with and / andnot / or
+		inRange = _mm_sub_epi32(inRange, _mm_castps_si128(inRangeMask));
+		bestDist = _mm_or_ps(_mm_and_ps(closerMask, distSq), _mm_andnot_ps(closerMask, bestDist));
+		bestIndex = _mm_or_si128(_mm_and_si128(closerMaskI, index), _mm_andnot_si128(closerMaskI, bestIndex));
+		index = _mm_add_epi32(index, _mm_set1_epi32(lanes));
+	}
+
+	float laneDist[lanes];
+	int32_t laneIndex[lanes];
+	int32_t laneInRange[lanes];
+	_mm_storeu_ps(laneDist, bestDist);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(laneIndex), bestIndex);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(laneInRange), inRange);
+
+	for (const int32_t count : laneInRange)
+		result.inRange += static_cast<unsigned>(count);
+	simd::reduceLanes(laneDist, laneIndex, result, closestDistSq);
+#endif
+
+	simd::closestNeighbourScalar(neighbours, i, position, radius, visualRangeSq, result, closestDistSq);
+	return result;
+}
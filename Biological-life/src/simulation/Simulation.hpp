@@ -1,53 +1,23 @@
 #pragma once
 
 #include <SFML/Graphics.hpp>
-#include <chrono>
 
-#include "../SpatialHashGrid/spatialHashGrid.h"
-#include "../Life/cell.hpp"
-#include "../Life/plant.hpp"
-#include "o_vector.hpp"
+#include "World.hpp"
+#include "../buffer/Buffer.hpp"
 #include "zooming.hpp"
+#include "scheduler.hpp"
 
 #include <string>
 
 
-struct DeltaTime
+/*
+ * Simulation
+ *
+ * the rendering layer that sits on top of World, it owns the window, the vertex buffer and the camera. All of the
+ * simulation logic lives in World, this class only mirrors entity changes into the Buffer through the hooks.
+ */
+class Simulation : public World, ZoomManagement
 {
-	DeltaTime()
-	{
-		m_start = std::chrono::high_resolution_clock::now();
-	}
-
-	double GetDelta()
-	{
-		const auto currentTime = std::chrono::high_resolution_clock::now();
-		const auto delta = currentTime - m_start;
-		m_start = currentTime;
-		return std::chrono::duration_cast<std::chrono::duration<double>>(delta).count();
-	}
-
-private:
-	std::chrono::high_resolution_clock::time_point m_start;
-};
-
-
-class Simulation : Settings, DeltaTime, ZoomManagement
-{
-	// ---------- borders and boundaries ---------- //
-	sf::Rect<float> m_border{ 0, 0, windowSize.x, windowSize.y }; // window space
-
-	// in the simulation we will slowly change the simbounds to a more scarce environment
-	sf::Rect<float> m_DesiredBounds{ 0, 0, windowSize.x / scaleFactor, windowSize.y / scaleFactor };
-	sf::Rect<float> m_simBounds = resizeRect(m_DesiredBounds, { sim_init_buffer, sim_init_buffer });
-
-
-	// ---------- spatial hash grid ---------- //
-	sf::Vector2u hashCells = {
-		static_cast<unsigned>(static_cast<float>(hashGridCells.x) / scaleFactor),
-		static_cast<unsigned>(static_cast<float>(hashGridCells.y) / scaleFactor) };
-	SpatialHashGrid m_hashGrid{};
-
 	// ---------- SFML window ---------- //
 	sf::Clock m_clock{};
 	sf::RenderWindow m_window{sf::VideoMode(
@@ -55,18 +25,28 @@ class Simulation : Settings, DeltaTime, ZoomManagement
 
 	// ---------- Vertex Buffer ---------- //
 	Buffer m_buffer;
+	sf::VertexBuffer m_renderGrid{};
 
-	// ---------- containers ---------- //
-	o_vector<Cell, maxCells>   m_Cells{};
-	o_vector<Plant, maxPlants> m_Plants{};
+	// ---------- level of detail ---------- //
+	// how many pixels across a cell has to be before it is drawn with more than a point / a few triangles
+	static constexpr float lowDetailPixels = 4.f;
+	static constexpr float fullDetailPixels = 16.f;
 
-	std::vector<Cell*>  m_nearbyCells{};
-	std::vector<Plant*> m_nearbyPlants{};
+	// ---------- culling ---------- //
+	sf::Rect<float> m_visibleArea{};
+	std::vector<unsigned> m_visibleCells{};  // slots
+	std::vector<unsigned> m_visiblePlants{}; // slots
 
 	// ---------- debugging ---------- //
-	sf::CircleShape debugCircle{};
-	sf::CircleShape debugVRange{};
-	sf::CircleShape debugCircleSize{};
+	// every debug shape of a frame is written into one of these and each is drawn in a single call
+	std::vector<sf::Vertex> m_debugTriangles{}; // centres and rings
+	std::vector<sf::Vertex> m_debugLines{};     // velocities, displacements and closest entities
+
+	static constexpr unsigned debugCirclePoints = 24;
+	std::vector<sf::Vector2f> m_debugCircle{}; // a circle with a radius of 1, the first point repeated at the end
+	float m_debugCenterRadius = 0;
+	float m_debugVRangeThickness = 0;
+	float m_debugSizeThickness = 0;
 
 	bool m_debugVRangeToggle  = false;
 	bool m_debugCircToggle    = false;
@@ -79,27 +59,14 @@ class Simulation : Settings, DeltaTime, ZoomManagement
 	bool m_paused       = false;
 	bool m_drawGrid     = false;
 	bool m_closeSim     = false;
-	bool m_autoSaving   = false;
 	bool m_frameByFrame = false;
-	bool m_thermal      = false;
-
-
-	// ---------- other statistics ---------- //
-	unsigned long long totalFrameCount = 0;
-	unsigned long long relativeFrameCount = 0;
-	unsigned           totalExtinctions = 0;
-	unsigned           updateCounter = 0;
-	double             totalRunTime = 0;
-
-	std::vector<unsigned> cellPopulation{ };
-	std::vector<unsigned> plantPopulation{ };
-	std::vector<float>    avgReproCount{ };
-	std::vector<float>    avgLifeTime{ };
 
 
 	// ---------- camera movement ---------- //
 	bool m_mousePressed = false;
 
+	// ---------- tick scheduling ---------- //
+	TickScheduler m_scheduler{};
 
 
 public:
@@ -107,69 +74,34 @@ public:
 	void run();
 
 
-private: // physics
-	void tickFrame();
-	void endFrame(double deltaTime);
-	void alignCells();
-	void prepGrid();
-
-	void initStatisticVariables();
-	void saveData();
-	void loadData();
-	void clearEntityData();
+private: // ticking
+	void runTick();
 
-	void updatePlants();
-	void bufferPosUpdate(const Allocations& entityAllocations, sf::Vector2f deltaPos);
-	void bufferColorUpdate(const Allocations& entityAllocations, sf::Color newColor);
-	
-	void prepareCells();
-	void updateCells();
 
-	template<class E>
-	void removeEntity(E* entity, bool type);
+private: // buffer
+	void findVisibleEntities();
+	[[nodiscard]] Buffer::Detail chooseDetail() const;
+	void generateVertices();
 
 	template<class E, unsigned N>
-	void alignEntites(o_vector<E, N>& entities);
-
-	template <class E, unsigned N>
-	void updateEntityPosition(o_vector<E, N>& entities);
-
-	template <class E, unsigned N>
-	void addAndRemoveEntities(o_vector<E, N>& entities, bool isCell);
-
-	template<class E, unsigned N>
-	bool addEntity(o_vector<E, N>& entities, E* entity, const bool isCell);
+	void generateVertices(o_vector<E, N>& entities, const std::vector<unsigned>& visible);
 
+	Allocations allocateEntity(sf::Vector2f position, float radius, sf::Color color) override;
+	void bufferColorUpdate(const Allocations& entityAllocations, sf::Color newColor) override;
 
 
 private: // rendering
 	void pollEvents();
-	void printStatistics();
-	void updateStatistics();
-	void updateCellStatistics();
 	void keyPressEvents(const sf::Keyboard::Key& event_key_code);
 	void renderFrame();
+	[[nodiscard]] std::string getTitle() const;
 
+	void initDebuging();
+	void initGridRender();
+	void drawGridLines();
 	void debugEntities();
 	void debugEntity(const Entity* entity, float vrange, float initRad);
-
-
-private: // other
-	void initLife();
-	void initDebuging();
-
-	Entity createEntity(sf::Color color, float radius);
-	void createCells();
-	void createPlants();
-
-	static int encodeEntityToId(unsigned index, bool type);
-	void decodeEntityIds(std::vector<Cell*>& nearby_cells, std::vector<Plant*>& nearby_plants, const c_Vec&
-	                     nearbyIds);
-
-	template <class E, unsigned N>
-	void overflowCheckEntities(o_vector<E, N>& entities, unsigned maxEntities, const bool type);
-
-	void overflowProtection(unsigned maxcells, unsigned maxplants);
-	void plantUnderflowProtection(unsigned minplants);
-	void extinctionCheck();
+	void addDebugDisc(sf::Vector2f center, float radius, sf::Color color);
+	void addDebugRing(sf::Vector2f center, float radius, float thickness, sf::Color color);
+	void addDebugLine(sf::Vector2f start, sf::Vector2f end, sf::Color color);
 };
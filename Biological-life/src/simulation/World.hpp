@@ -0,0 +1,240 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/Color.hpp>
+#include <chrono>
+
+#include "../SpatialHashGrid/spatialHashGrid.h"
+#include "../SpatialHashGrid/countingSortGrid.h"
+#include "../Life/cell.hpp"
+#include "../Life/Plant.hpp"
+#include "../settings.hpp"
+#include "../profiler/Profiler.hpp"
+#include "o_vector.hpp"
+#include "../threading/ThreadPool.hpp"
+
+#include <string>
+
+/*
+ * World
+ *
+ * the headless core of the simulation, it owns all of the entities, the spatial hash grid and the tick logic.
+ * nothing in here touches an sf::RenderWindow, an sf::VertexBuffer or the Buffer, which means it can be built and
+ * run on machines with no display or GPU. Simulation sits on top of it and adds the rendering layer through the
+ * buffer hooks at the bottom of this class.
+ */
+
+
+struct DeltaTime
+{
+	DeltaTime()
+	{
+		m_start = std::chrono::high_resolution_clock::now();
+	}
+
+	double GetDelta()
+	{
+		const auto currentTime = std::chrono::high_resolution_clock::now();
+		const auto delta = currentTime - m_start;
+		m_start = currentTime;
+		return std::chrono::duration_cast<std::chrono::duration<double>>(delta).count();
+	}
+
+private:
+	std::chrono::high_resolution_clock::time_point m_start;
+};
+
+
+// the containers a thread needs to run a spatial query, one of these exists per thread in the pool
+struct NearbyScratch
+{
+	c_Vec found{};
+	std::vector<unsigned> cells{};  // slots
+	std::vector<unsigned> plants{}; // slots
+	std::vector<Plant*> nearbyPlants{};
+	PackedNeighbours packed{};
+};
+
+
+class World : protected Settings, protected DeltaTime
+{
+protected:
+	// ---------- borders and boundaries ---------- //
+	sf::Rect<float> m_border{ 0, 0, windowSize.x, windowSize.y }; // window space
+
+	// in the simulation we will slowly change the simbounds to a more scarce environment
+	sf::Rect<float> m_DesiredBounds{ 0, 0, windowSize.x / scaleFactor, windowSize.y / scaleFactor };
+	sf::Rect<float> m_simBounds = resizeRect(m_DesiredBounds, { sim_init_buffer, sim_init_buffer });
+
+
+	// ---------- spatial hash grid ---------- //
+	sf::Vector2u hashCells = {
+		static_cast<unsigned>(static_cast<float>(hashGridCells.x) / scaleFactor),
+		static_cast<unsigned>(static_cast<float>(hashGridCells.y) / scaleFactor) };
+	SpatialHashGrid m_hashGrid{};
+	CountingSortGrid m_sortedGrid{}; // used instead of m_hashGrid when gridBackend is CountingSort
+	GridOverflowStats m_gridOverflow{};
+	bool m_gridCurrent = false; // the grid matches where the entities are now, it stops being when a tick ends
+
+	// ---------- containers ---------- //
+	Kinematics m_cellKinematics{};
+	Kinematics m_plantKinematics{};
+
+	o_vector<Cell, maxCells>   m_Cells{};
+	o_vector<Plant, maxPlants> m_Plants{};
+
+	// ---------- threading ---------- //
+	ThreadPool m_threadPool;
+	std::vector<NearbyScratch> m_nearbyScratch{};
+	std::vector<uint8_t> m_crowdedCells{};
+	std::vector<CellContact> m_cellContacts{};
+	CellNetworkBatch m_cellNetworks{};
+
+	// plant slots sorted into stripes of grid columns, see updatePlants()
+	static constexpr unsigned plantStripeWidth = 2;
+	std::vector<std::vector<unsigned>> m_plantStripes{};
+	std::vector<unsigned> m_plantColumns{};
+
+	// ---------- runtime variables ---------- //
+	bool m_autoSaving   = false;
+	bool m_thermal      = false;
+
+
+	// ---------- other statistics ---------- //
+	unsigned long long totalFrameCount = 0;
+	unsigned long long relativeFrameCount = 0;
+	unsigned           totalExtinctions = 0;
+	unsigned           updateCounter = 0;
+	double             totalRunTime = 0;
+
+	std::vector<unsigned> cellPopulation{ };
+	std::vector<unsigned> plantPopulation{ };
+	std::vector<float>    avgReproCount{ };
+	std::vector<float>    avgLifeTime{ };
+
+
+	// ---------- profiling ---------- //
+	Profiler    m_profiler{};
+	unsigned    m_traceExportFreq = 0; // 0 = only export on request
+	std::string m_traceFileName = "trace.json";
+
+
+public:
+	// when initialise is false the caller is expected to call initLife() once it is fully constructed, this is how
+	// Simulation makes sure its buffer hooks are in place before any entity is created
+	explicit World(const Settings& settings, bool initialise = true);
+	virtual ~World() = default;
+
+	World(const World&) = delete;
+	World& operator=(const World&) = delete;
+
+	// runs the simulation for a fixed number of ticks with no rendering, then returns
+	void runTicks(unsigned long long ticks);
+	void tick(double deltaTime);
+
+	[[nodiscard]] unsigned getCellCount()  const { return m_Cells.size(); }
+	[[nodiscard]] unsigned getPlantCount() const { return m_Plants.size(); }
+	[[nodiscard]] unsigned long long getTotalFrameCount() const { return totalFrameCount; }
+	[[nodiscard]] unsigned getTotalExtinctions() const { return totalExtinctions; }
+	[[nodiscard]] unsigned getThreadCount() const { return m_threadPool.size(); }
+
+	// how often the grid cells overflowed, for sizing hashGridCells
+	[[nodiscard]] const GridOverflowStats& getGridOverflow() const { return m_gridOverflow; }
+	void printGridOverflow() const;
+
+	// a hash of every live entity's position, used to check that two runs from the same seed are identical
+	[[nodiscard]] std::size_t computeChecksum();
+
+	// profiling, a trace is written every frequency ticks (0 disables the periodic export)
+	void setTraceExport(unsigned frequency, const std::string& fileName = "trace.json");
+	void exportTrace() const;
+	[[nodiscard]] const Profiler& getProfiler() const { return m_profiler; }
+
+
+protected: // physics
+	void tickFrame();
+	// a paused frame still counts towards the frame count and run time, it just isn't recorded in the statistics
+	void endFrame(double deltaTime, bool paused = false);
+	void prepGrid();
+	// lossless keeps every id in a full fixed grid cell, the counting sort grid always does
+	void buildGrid(bool lossless);
+
+	// visit(slot, isCell) for every entity the grid has in the grid cells that area touches
+	template<class Visit>
+	void forEachInArea(const sf::Rect<float> area, Visit&& visit) const
+	{
+		const auto decode = [&visit](const int32_t id)
+		{
+			if (id > 0)
+				visit(static_cast<unsigned>(id - 1), true);
+			else if (id < 0)
+				visit(static_cast<unsigned>(id * -1 - 1), false);
+		};
+
+		if (gridBackend == GridBackend::CountingSort)
+			m_sortedGrid.forEachInArea(area, decode);
+		else
+			m_hashGrid.forEachInArea(area, decode);
+	}
+
+	void initLife();
+	void initStatisticVariables();
+	void saveData();
+	void loadData();
+	void clearEntityData();
+
+	void updatePlants();
+
+	void prepareCells();
+	void prepareCell(Cell* cell, NearbyScratch& scratch);
+	[[nodiscard]] Neighbours neighboursOf(const Cell* cell);
+	void cellInference();
+	template<Activation A>
+	void runCellInference();
+	void updateCells();
+
+	void findNearby(sf::Vector2f position, NearbyScratch& scratch);
+
+	template<class E>
+	void removeEntity(E* entity, bool type);
+
+	template <class E, unsigned N>
+	void updateEntityPosition(o_vector<E, N>& entities);
+
+	template <class E, unsigned N>
+	void addAndRemoveEntities(o_vector<E, N>& entities, bool isCell);
+
+	template<class E, unsigned N>
+	bool addEntity(o_vector<E, N>& entities, E* entity, const bool isCell);
+
+
+protected: // statistics
+	void printStatistics();
+	void updateStatistics();
+	void updateCellStatistics();
+
+
+protected: // other
+	Entity createEntity(Kinematics& kinematics, unsigned slot, sf::Color color, float radius, Random& rng);
+	void createCells();
+	void createPlants();
+
+	static int encodeEntityToId(unsigned index, bool type);
+	static void decodeEntityIds(std::vector<unsigned>& nearby_cells, std::vector<unsigned>& nearby_plants, const c_Vec&
+	                            nearbyIds);
+
+	template <class E, unsigned N>
+	void overflowCheckEntities(o_vector<E, N>& entities, unsigned maxEntities, const bool type);
+
+	void overflowProtection(unsigned maxcells, unsigned maxplants);
+	void plantUnderflowProtection(unsigned minplants);
+	void extinctionCheck();
+
+
+protected: // buffer hooks, these do nothing when running headless
+	// every live entity is placed from its position when the vertices are uploaded and only what is placed is drawn,
+	// so there are no hooks for moving or removing entities
+	virtual Allocations allocateEntity(sf::Vector2f /*position*/, float /*radius*/, sf::Color /*color*/) { return {}; }
+	virtual void bufferColorUpdate(const Allocations& /*entityAllocations*/, sf::Color /*newColor*/) {}
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * EntityHandle
+ *
+ * a reference to an object stored in an o_vector, its slot and the slot's generation packed into 32 bits. o_vector
+ * bumps a slot's generation every time the slot is removed, so a handle to an object that has gone never resolves
+ * to whatever reuses the slot afterwards, even within the same tick. Handles are what entities keep to refer to each
+ * other, o_vector::resolve() turns one back into a pointer.
+ */
+
+
+struct EntityHandle
+{
+	static constexpr unsigned slotBits = 20; // a million slots, the generation gets the other 12 bits
+	static constexpr uint32_t slotMask = (1u << slotBits) - 1;
+	static constexpr uint32_t generationMask = (1u << (32 - slotBits)) - 1;
+	static constexpr uint32_t nullValue = UINT32_MAX;
+
+	uint32_t value = nullValue;
+
+	EntityHandle() = default;
+	EntityHandle(const unsigned slot, const uint32_t generation) : value(((generation & generationMask) << slotBits) | slot) {}
+
+	[[nodiscard]] bool isNull() const { return value == nullValue; }
+	[[nodiscard]] unsigned slot() const { return value & slotMask; }
+	[[nodiscard]] uint32_t generation() const { return value >> slotBits; }
+
+	bool operator==(const EntityHandle& other) const = default;
+};
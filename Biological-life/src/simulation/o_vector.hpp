@@ -3,11 +3,23 @@
 #include <numeric>
 #include <ranges>
 #include <array>
+#include <vector>
+
+#include "handle.hpp"
 /*
  * struct Entity;
  * struct Wrapper;
  *
+ * every object is stored once and keeps its slot (vector_id) for good, the slots are only ever switched on and off.
+ * the active slots are kept in a dense list and the inactive ones on a stack, so add() and remove() are O(1) and a
+ * loop over the objects only visits the live ones.
+ *
+ * loops run backwards over the live list. remove() fills the gap with the last live slot, which a backwards loop
+ * has already visited, so the object being visited can be removed mid-loop without anything being skipped or seen
+ * twice. Objects added mid-loop go on the end of the list and aren't visited by that loop. Removing any other
+ * object mid-loop is not safe.
  *
+ * every slot has a generation that goes up each time it is removed, see EntityHandle
  */
 
 
@@ -27,20 +39,26 @@ struct Wrapper
 };
 
 
-template <class Obj, std::size_t N>
+template <class Obj, unsigned N>
 class o_vector
 {
+    static_assert(N <= EntityHandle::slotMask, "too many slots for an EntityHandle");
+
     // this array contains all of the items and is never directly modified
     std::array<Wrapper<Obj>, N> array{};
     unsigned arrayRealSize = 0;
-    unsigned m_indexSize = 0;
 
     // this vector stores all the actual objects on the heap, they are never modified or removed from. only added to
     std::vector<Obj> objectStore{};
 
+    std::vector<unsigned> m_live{};        // the active slots, in no particular order
+    std::vector<unsigned> m_livePosition{}; // where each active slot is in m_live
+    std::vector<unsigned> m_free{};        // the inactive slots, the last one freed is reused first
+    std::vector<uint32_t> m_generation{};  // per slot
+
 
 private:
-    // Iterator class definition
+    // Iterator class definition, walks the live list from the back
     class Iterator
     {
     public:
@@ -50,72 +68,101 @@ private:
         using pointer   = Obj*;
         using reference = Obj*;
 
-        explicit Iterator(o_vector& vec, const unsigned index) : vector(vec), currentIndex(index) {}
+        explicit Iterator(o_vector& vec, const unsigned remaining) : vector(vec), remaining(remaining) {}
 
         Iterator& operator++()
         {
-            do { ++currentIndex; } while (currentIndex < vector.array.size() && !vector.array[currentIndex].active);
+            --remaining;
             return *this;
         }
 
-        reference operator*() const { return vector.array[currentIndex].get(); }
-        pointer operator->()  const { return vector.array[currentIndex].get(); }
+        reference operator*() const { return vector.array[vector.m_live[remaining - 1]].get(); }
+        pointer operator->()  const { return vector.array[vector.m_live[remaining - 1]].get(); }
 
-        bool operator==(const Iterator& other) const { return currentIndex == other.currentIndex; }
+        bool operator==(const Iterator& other) const { return remaining == other.remaining; }
         bool operator!=(const Iterator& other) const { return !(*this == other); }
 
     private:
         o_vector& vector;
-        unsigned currentIndex = 0;
+        unsigned remaining = 0; // the live slots still to visit, the current one is m_live[remaining - 1]
     };
 
 
-    unsigned getFirstAvalableIteration()
+public:
+    explicit o_vector()
     {
-        unsigned currentIndex = 0;
-        while (currentIndex < N && !array[currentIndex].active)
-            ++currentIndex;
-        return currentIndex;
+        objectStore.reserve(N);
+        m_live.reserve(N);
+        m_livePosition.reserve(N);
+        m_free.reserve(N);
+        m_generation.reserve(N);
     }
 
-public:
-    explicit o_vector() { objectStore.reserve(N); }
-
-    Iterator begin() { return Iterator(*this, getFirstAvalableIteration()); }
-    Iterator end()   { return Iterator(*this, N); }
-    [[nodiscard]] unsigned size() const { return m_indexSize; }
+    Iterator begin() { return Iterator(*this, static_cast<unsigned>(m_live.size())); }
+    Iterator end()   { return Iterator(*this, 0); }
+    [[nodiscard]] unsigned size() const { return static_cast<unsigned>(m_live.size()); }
 
     // used exlusevly to initilise the array, else use add()
     void emplace(Obj item)
     {
         objectStore.emplace_back(item);
-	    array[arrayRealSize++] = Wrapper<Obj>(&objectStore[m_indexSize++]);
+        m_livePosition.push_back(static_cast<unsigned>(m_live.size()));
+        m_live.push_back(arrayRealSize);
+        m_generation.push_back(0);
+	    array[arrayRealSize++] = Wrapper<Obj>(&objectStore.back());
     }
     Obj* at(const unsigned i) { return array[i].get(); }
 
+    // slot based access, used when a loop over the entities is split between threads
+    [[nodiscard]] unsigned slots() const { return arrayRealSize; }
+    [[nodiscard]] bool isActive(const unsigned i) const { return array[i].active; }
+
+    // the i'th live slot, for splitting a loop over only the live objects between threads
+    [[nodiscard]] unsigned liveSlot(const unsigned i) const { return m_live[i]; }
+
+    [[nodiscard]] EntityHandle handle(const unsigned slot) const { return { slot, m_generation[slot] }; }
+
+    // nullptr when the handle is null or the object it was made for has been removed since
+    Obj* resolve(const EntityHandle handle)
+    {
+        const unsigned slot = handle.slot();
+        if (handle.isNull() || slot >= arrayRealSize || !array[slot].active || m_generation[slot] != handle.generation())
+            return nullptr;
+
+        return array[slot].get();
+    }
+
 
     Obj* add()
     {
-        if (size() >= arrayRealSize)
+        if (m_free.empty())
             return nullptr;
 
-        for (size_t i{ 0 }; i < arrayRealSize; ++i)
-        {
-            if (!array[i].active)
-            {
-                array[i].active = true;
-                ++m_indexSize;
-                return array[i].get();
-            }
-        }
+        const unsigned slot = m_free.back();
+        m_free.pop_back();
 
-        return nullptr;
+        array[slot].active = true;
+        m_livePosition[slot] = static_cast<unsigned>(m_live.size());
+        m_live.push_back(slot);
+        return array[slot].get();
     }
 
-    void remove(Obj* obj) { if (obj->active) remove(obj->o_vector_index); }
+    void remove(Obj* obj) { remove(obj->vector_id); }
     void remove(const unsigned vector_index)
     {
+        if (!array[vector_index].active)
+            return;
+
         array[vector_index].active = false;
-        --m_indexSize;
+        m_generation[vector_index] = (m_generation[vector_index] + 1) & EntityHandle::generationMask;
+
+        // the last live slot takes the removed one's place
+        const unsigned position = m_livePosition[vector_index];
+        const unsigned last = m_live.back();
+        m_live[position] = last;
+        m_livePosition[last] = position;
+        m_live.pop_back();
+
+        m_free.push_back(vector_index);
     }
-};
\ No newline at end of file
+};
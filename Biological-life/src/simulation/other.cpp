@@ -1,34 +1,49 @@
-#include "Simulation.hpp"
+#include "World.hpp"
 
 #include <nlohmann/json.hpp>
 #include <fstream> // for std::ofstream
 
 
-Simulation::Simulation(const Settings& settings)
+World::World(const Settings& settings, const bool initialise)
 	: Settings(settings),
-	ZoomManagement(m_simBounds, scaleFactor),
 	m_hashGrid(m_DesiredBounds, hashCells),
-	m_buffer(maxCells + maxPlants, objectCirclePoints)
+	m_sortedGrid(m_DesiredBounds, hashCells),
+	m_threadPool(threadCount)
 {
 	// changing the border to be one spatial cell inwards, this improves cashe hits as it removes boundary checks from the find() query
 	m_border = resizeRect(m_border, m_hashGrid.m_cellDimensions);
 	m_simBounds = resizeRect(m_simBounds, m_hashGrid.m_cellDimensions);
 
 	initStatisticVariables();
-	initLife();
-	initDebuging();
+
+	if (initialise)
+		initLife();
 }
 
 
-void Simulation::initLife()
+void World::initLife()
 {
 
 	if (minPlants > maxPlants)
 		minPlants = maxPlants;
 
-	m_nearbyCells.reserve(static_cast<unsigned long long>(CollisionCell::cell_capacity) * 9);
-	m_nearbyPlants.reserve(static_cast<unsigned long long>(CollisionCell::cell_capacity) * 9);
-
+	m_nearbyScratch.resize(m_threadPool.size());
+	for (NearbyScratch& scratch : m_nearbyScratch)
+	{
+		scratch.cells.reserve(c_Vec::max);
+		scratch.plants.reserve(c_Vec::max);
+		scratch.nearbyPlants.reserve(c_Vec::max);
+		scratch.packed.reserve(c_Vec::max);
+	}
+	m_cellKinematics.resize(maxCells);
+	m_plantKinematics.resize(maxPlants);
+	m_crowdedCells.resize(maxCells, 0);
+	m_cellContacts.resize(maxCells);
+	m_cellNetworks.resize(maxCells);
+	m_plantColumns.resize(maxPlants, 0);
+
+	// the spawn streams are keyed off the tick, which is shared between worlds, so start it from this world's frame
+	Random::setTick(totalFrameCount);
 	createCells();
 	createPlants();
 	std::cout << "entities initilised" << "\n";
@@ -37,59 +52,42 @@ void Simulation::initLife()
 }
 
 
-void Simulation::initDebuging()
-	{
-	// debug circle for entity center
-	debugCircle.setRadius(2.f * scaleFactor);
-	debugCircle.setFillColor({ 255, 0, 0 });
-
-	// circle used for entity visual range
-	debugVRange.setRadius(PlantSettings::visualRange);
-	debugVRange.setOutlineColor({ 255, 0, 0 });
-	debugVRange.setOutlineThickness(.6f * scaleFactor);
-	debugVRange.setFillColor({ 0, 0, 0, 0 });
-
-	// circle used for entity size
-	debugCircleSize.setRadius(PlantSettings::initMass);
-	debugCircleSize.setOutlineColor({ 255, 0, 0 });
-	debugCircleSize.setOutlineThickness(.4f * scaleFactor);
-	debugCircleSize.setFillColor({ 0, 0, 0, 0 });
-}
-
-
-Entity Simulation::createEntity(const sf::Color color, const float radius)
+Entity World::createEntity(Kinematics& kinematics, const unsigned slot, const sf::Color color, const float radius, Random& rng)
 {
-	const sf::Vector2f position = randPosInRect(resizeRect(m_simBounds, m_hashGrid.m_cellDimensions));
-	Entity entity(m_buffer.add(position, radius), &m_simBounds, color, radius);
+	const sf::Vector2f position = randPosInRect(rng, resizeRect(m_simBounds, m_hashGrid.m_cellDimensions));
+	Entity entity(allocateEntity(position, radius, color), &kinematics, slot, &m_simBounds, color, radius);
 
 	entity.setEntityPosition(position);
-	m_buffer.setColor({ entity.indexes }, color);
 	return entity;
 }
 
 
-void Simulation::createCells()
+void World::createCells()
 {
 	for (unsigned i{ 0 }; i < maxCells; i++)
 	{
-		const Cell cell{ createEntity(Genome::randCellColor(), PlantSettings::initMass + 4), Genome(), i};
+		Random rng = Random::forEntity(i, Random::CellSpawn);
+		const sf::Color color = Genome::randCellColor(rng);
+		const Cell cell{ createEntity(m_cellKinematics, i, color, PlantSettings::initMass + 4, rng), Genome(), i, rng };
 		m_Cells.emplace(cell);
 	}
 }   
 
 
-void Simulation::createPlants()
+void World::createPlants()
 {
 	for (unsigned i{ 0 }; i < maxPlants; i++)
 	{
-		const sf::Color color = Plant::generateColor();
-		const Plant plant{ createEntity(color, PlantSettings::initMass), randfloat(0, 100), i };
+		Random rng = Random::forEntity(i, Random::PlantSpawn);
+		const sf::Color color = Plant::generateColor(rng);
+		const Entity entity = createEntity(m_plantKinematics, i, color, PlantSettings::initMass, rng);
+		const Plant plant{ entity, randfloat(rng, 0, 100), i };
 		m_Plants.emplace(plant);
 	}
 }
 
 
-int Simulation::encodeEntityToId(const unsigned index, const bool type)
+int World::encodeEntityToId(const unsigned index, const bool type)
 {
 	/* encoding entities into an integer value, cells (type = true) > 0, plants (type = false) < 0 */
 	if (type == true) return static_cast<int>(index + 1);
@@ -97,39 +95,40 @@ int Simulation::encodeEntityToId(const unsigned index, const bool type)
 }
 
 
-void Simulation::decodeEntityIds(std::vector<Cell*>& nearby_cells, std::vector<Plant*>& nearby_plants, const c_Vec& nearbyIds)
+void World::decodeEntityIds(std::vector<unsigned>& nearby_cells, std::vector<unsigned>& nearby_plants, const c_Vec& nearbyIds)
 {
-	for (int32_t i{ 0 }; i < nearbyIds.size; i++)
+	for (unsigned i{ 0 }; i < nearbyIds.size; i++)
 	{
-		if (const int32_t id = nearbyIds.array[i]; id > 0)
-			nearby_cells.emplace_back(m_Cells.at(id - 1));
+		if (const int32_t id = nearbyIds.at(i); id > 0)
+			nearby_cells.emplace_back(id - 1);
 
 		else if (id < 0)
-			nearby_plants.emplace_back(m_Plants.at(id * -1 - 1));
+			nearby_plants.emplace_back(id * -1 - 1);
 	}
 }
 
 
 
 
-void Simulation::plantUnderflowProtection(const unsigned minplants)
+void World::findNearby(const sf::Vector2f position, NearbyScratch& scratch)
+{
+	// clearing the recycled containers and filling them with new entities
+	scratch.cells.clear();
+	scratch.plants.clear();
+
+	if (gridBackend == GridBackend::CountingSort)
+		m_sortedGrid.find(position, scratch.found);
+	else
+		m_hashGrid.find(position, scratch.found);
+	decodeEntityIds(scratch.cells, scratch.plants, scratch.found);
+}
+
+
+void World::plantUnderflowProtection(const unsigned minplants)
 {
 	while (m_Plants.size() < minplants)
 	{
 		Plant* plant = m_Plants.add();
 		plant->createRandom();
-		m_buffer.setVertexPositions({ plant->indexes }, plant->getDeltaPos());
 	}
 }
-
-
-
-void Simulation::bufferPosUpdate(const Allocations& entityAllocations, const sf::Vector2f deltaPos)
-{
-	m_buffer.setVertexPositions(entityAllocations, deltaPos);
-}
-
-void Simulation::bufferColorUpdate(const Allocations& entityAllocations, const sf::Color newColor)
-{
-	m_buffer.setColor(entityAllocations, newColor);
-}
\ No newline at end of file
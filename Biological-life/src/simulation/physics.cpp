@@ -1,50 +1,48 @@
-#include "Simulation.hpp"
+#include "World.hpp"
 #include "../Life/entity.hpp"
 
-void Simulation::run()
+void World::runTicks(const unsigned long long ticks)
 {
-	while (!m_closeSim)
-	{
-		const double deltaTime = GetDelta();
-
-		if (!m_paused)
-			tickFrame();
-		endFrame(deltaTime);
-		renderFrame();
-	}
+	for (unsigned long long i{ 0 }; i < ticks; i++)
+		tick(GetDelta());
 }
 
 
-void Simulation::tickFrame()
+void World::tick(const double deltaTime)
 {
-	prepGrid();
-
-	addAndRemoveEntities(m_Cells, true);
-	addAndRemoveEntities(m_Plants, false);
+	tickFrame();
+	endFrame(deltaTime);
+}
 
-	updatePlants();
-	prepareCells();
 
-	updateCells();
+void World::tickFrame()
+{
+	m_profiler.setTick(totalFrameCount);
+	Random::setTick(totalFrameCount);
 
-	overflowProtection(maxCells, maxPlants);
-	plantUnderflowProtection(minPlants);
-	extinctionCheck();
+	m_profiler.measure(Phase::PrepGrid, [this] { prepGrid(); });
 
+	m_profiler.measure(Phase::AddRemoveCells,  [this] { addAndRemoveEntities(m_Cells, true); });
+	m_profiler.measure(Phase::AddRemovePlants, [this] { addAndRemoveEntities(m_Plants, false); });
 
-	if (totalFrameCount % alignmentFreq == 0)
-		alignEntites(m_Cells);
+	m_profiler.measure(Phase::UpdatePlants, [this] { updatePlants(); });
+	m_profiler.measure(Phase::PrepareCells, [this] { prepareCells(); });
+	m_profiler.measure(Phase::CellInference, [this] { cellInference(); });
 
-	m_buffer.update();
+	m_profiler.measure(Phase::UpdateCells,  [this] { updateCells(); });
 
+	m_profiler.measure(Phase::OverflowProtection, [this]
+	{
+		overflowProtection(maxCells, maxPlants);
+		plantUnderflowProtection(minPlants);
+		extinctionCheck();
+	});
 }
 
-void Simulation::endFrame(const double deltaTime)
+void World::endFrame(const double deltaTime, const bool paused)
 {
-	// allows the user to manually tick through frames
-	if (m_frameByFrame) m_paused = true;
-
-	// updating runtime statistics and ending the frame
+	// updating runtime statistics and ending the frame, nothing moves on a paused frame so the grid is still current
+	m_gridCurrent = m_gridCurrent && paused;
 	totalFrameCount++;
 	relativeFrameCount++;
 	totalRunTime += deltaTime;
@@ -54,104 +52,270 @@ void Simulation::endFrame(const double deltaTime)
 	if (m_simBounds.left - m_DesiredBounds.left > m_hashGrid.m_cellDimensions.x)
 		m_simBounds = resizeRect(m_simBounds, {boundarySF, boundarySF});
 
+	if (paused)
+		return;
+
 	updateStatistics();
 
+	if (m_traceExportFreq != 0 && totalFrameCount % m_traceExportFreq == 0)
+		exportTrace();
 }
 
-void Simulation::alignCells()
+
+void World::setTraceExport(const unsigned frequency, const std::string& fileName)
 {
-	alignEntites(m_Cells);
+	m_traceExportFreq = frequency;
+	m_traceFileName = fileName;
 }
 
-template<class E, unsigned N>
-void Simulation::alignEntites(o_vector<E, N>& entities)
+
+void World::exportTrace() const
 {
-	/* entities often fall out of sync with their display and real position so it is nessesery to re-align them every now and then */
-	for (E* entity : entities)
-	{
-		sf::Vector2f& actualCenter = m_buffer.getVertices()->at(entity->indexes[0] + 2).position;
-		sf::Vector2f desiredCenter = entity->getPosition();
-		sf::Vector2f delta = desiredCenter - actualCenter;
+	if (m_profiler.exportChromeTrace(m_traceFileName))
+		std::cout << "trace written to " << m_traceFileName << "\n";
+}
 
-		bufferPosUpdate({ entity->indexes }, delta);
-	}
+void World::prepGrid()
+{
+	buildGrid(losslessGrid);
+
+	if (gridBackend == GridBackend::CountingSort)
+		m_gridOverflow.record(m_sortedGrid.getGridCellCount(), m_sortedGrid.getMaxOccupancy(), 0);
+	else
+		m_gridOverflow.record(static_cast<uint32_t>(m_hashGrid.m_cells.size()), m_hashGrid.m_maxOccupancy,
+		                      m_hashGrid.m_idsPastCapacity, m_hashGrid.m_overflowedCells);
 }
 
 
-void Simulation::prepGrid()
+void World::buildGrid(const bool lossless)
 {
+	m_gridCurrent = true;
+
+	if (gridBackend == GridBackend::CountingSort)
+	{
+		// the live cells followed by the live plants, in the order a loop over them visits them (from the back of the
+		// live list) so the ids in a grid cell come out in the same order as the fixed grid's
+		const unsigned cellCount = m_Cells.size();
+		const unsigned plantCount = m_Plants.size();
+		m_sortedGrid.build(cellCount + plantCount, [this, cellCount, plantCount](const unsigned i, sf::Vector2f& position, int32_t& id)
+		{
+			if (i < cellCount)
+			{
+				const unsigned slot = m_Cells.liveSlot(cellCount - 1 - i);
+				position = m_cellKinematics.positionCurrent[slot];
+				id = encodeEntityToId(slot, true);
+				return true;
+			}
+
+			const unsigned slot = m_Plants.liveSlot(plantCount - 1 - (i - cellCount));
+			position = m_plantKinematics.positionCurrent[slot];
+			id = encodeEntityToId(slot, false);
+			return true;
+		}, m_threadPool);
+		return;
+	}
+
 	m_hashGrid.clear();
 
 	// first loop is for adding the cells
 	for (const Cell* cell : m_Cells)
-		m_hashGrid.addAtom(cell->getPosition(), encodeEntityToId(cell->vector_id, true));
+		m_hashGrid.addAtom(m_cellKinematics.positionCurrent[cell->vector_id], encodeEntityToId(cell->vector_id, true), lossless);
 	
 
 	// second loop is for adding the plants
 	for (const Plant* plant : m_Plants)
-		m_hashGrid.addAtom(plant->getPosition(), encodeEntityToId(plant->vector_id, false));
+		m_hashGrid.addAtom(m_plantKinematics.positionCurrent[plant->vector_id], encodeEntityToId(plant->vector_id, false), lossless);
 }
 
 
-void Simulation::updatePlants()
+void World::updatePlants()
 {
-	for (Plant* plant : m_Plants)
+	// plants push their neighbours around so they can't just be split between the threads like the cells are. They are
+	// sorted into stripes of grid columns instead (the red/black scheme VerletSFML-Multithread uses for its collisions),
+	// a plant only reaches into the columns either side of its own, so no two even stripes ever touch the same plant
+	// and they can all run at once, then the odd stripes do the same. The stripes don't depend on the thread count so
+	// neither does the result
+	m_plantStripes.resize((m_hashGrid.m_cellsXY.x + plantStripeWidth - 1) / plantStripeWidth);
+	for (std::vector<unsigned>& stripe : m_plantStripes)
+		stripe.clear();
+
+	const auto lastStripe = static_cast<unsigned>(m_plantStripes.size() - 1);
+	for (const Plant* plant : m_Plants)
 	{
-		m_nearbyCells.clear();
-		m_nearbyPlants.clear();
-		decodeEntityIds(m_nearbyCells, m_nearbyPlants, m_hashGrid.find(plant->getPosition()));
+		const unsigned column = m_hashGrid.posTo2dIdx(m_plantKinematics.positionCurrent[plant->vector_id]).x;
+		m_plantColumns[plant->vector_id] = column;
+		m_plantStripes[std::min(column / plantStripeWidth, lastStripe)].push_back(plant->vector_id);
+	}
 
-		plant->update(m_nearbyPlants);
+	for (unsigned pass{ 0 }; pass < 2; pass++)
+	{
+		const auto stripeCount = static_cast<unsigned>(m_plantStripes.size() + 1 - pass) / 2;
+		m_threadPool.dispatch(stripeCount, [this, pass](const unsigned start, const unsigned end, const unsigned thread)
+		{
+			NearbyScratch& scratch = m_nearbyScratch[thread];
+			for (unsigned i{ start }; i < end; i++)
+			{
+				for (const unsigned slot : m_plantStripes[i * 2 + pass])
+				{
+					Plant* plant = m_Plants.at(slot);
+					findNearby(m_plantKinematics.positionCurrent[slot], scratch);
+
+					// the grid is built before entities are added and removed, so a reused slot can still be listed
+					// where its old plant used to be. Those are dropped so a plant never reaches past the columns
+					// either side of its own
+					const unsigned column = m_plantColumns[slot];
+					scratch.nearbyPlants.clear();
+					for (const unsigned other : scratch.plants)
+					{
+						const unsigned otherColumn = m_plantColumns[other];
+						if (otherColumn + 1 >= column && otherColumn <= column + 1)
+							scratch.nearbyPlants.push_back(m_Plants.at(other));
+					}
+
+					plant->update(scratch.nearbyPlants);
+				}
+			}
+		});
 	}
 
 	updateEntityPosition(m_Plants);
 }
 
 
-void Simulation::prepareCells()
+void World::prepareCells()
 {
-	// this iteration updates all of the positions of the cells
-	for (Cell* cell : m_Cells)
+	// every cell only reads the grid and the other entities here, so the live cells are split between the thread pool
+	m_threadPool.dispatch(m_Cells.size(), [this](const unsigned start, const unsigned end, const unsigned thread)
 	{
-		// clearing the recycled containers and filling them with new entities
-		m_nearbyCells.clear();
-		m_nearbyPlants.clear();
-		decodeEntityIds(m_nearbyCells, m_nearbyPlants, m_hashGrid.find(cell->getPosition()));
+		NearbyScratch& scratch = m_nearbyScratch[thread];
+		for (unsigned i{ start }; i < end; i++)
+			prepareCell(m_Cells.at(m_Cells.liveSlot(i)), scratch);
+	});
+
+	// crouding deaths are applied afterwards so no cell sees a neighbour die part way through the scan
+	if (!cellCroudingDeath)
+		return;
 
-		// crouding death check
-		if (cellCroudingDeath && m_nearbyCells.size() >= c_Vec::max / 4)
+	for (Cell* cell : m_Cells)
+	{
+		if (m_crowdedCells[cell->vector_id])
 			cell->die();
+	}
+}
+
+
+void World::prepareCell(Cell* cell, NearbyScratch& scratch)
+{
+	const unsigned slot = cell->vector_id;
+	const sf::Vector2f position = m_cellKinematics.positionCurrent[slot];
+	const float radius = m_cellKinematics.radius[slot];
+
+	findNearby(position, scratch);
+
+	// crouding death check
+	m_crowdedCells[slot] = scratch.cells.size() >= c_Vec::max / 4;
+
+	// getting entity information
+	unsigned nearbyCellCount = 0;
+	unsigned nearbyPlantCount = 0;
+	const unsigned closestCell = filterAndProcessNearby(position, scratch.cells, m_cellKinematics, CellSettings::visualRadius, radius, nearbyCellCount, scratch.packed);
+	const unsigned closestPlant = filterAndProcessNearby(position, scratch.plants, m_plantKinematics, PlantSettings::visualRange, radius, nearbyPlantCount, scratch.packed);
+
+	// setting the information in the cell to be used for later
+	const EntityHandle closestCellHandle  = closestCell  == noEntity ? EntityHandle{} : m_Cells.handle(closestCell);
+	const EntityHandle closestPlantHandle = closestPlant == noEntity ? EntityHandle{} : m_Plants.handle(closestPlant);
+	cell->setClosestEntities(closestCellHandle, closestPlantHandle,
+		{ m_Cells.resolve(closestCellHandle), m_Plants.resolve(closestPlantHandle) },
+		nearbyCellCount, nearbyPlantCount);
+}
+
+
+Neighbours World::neighboursOf(const Cell* cell)
+{
+	return { m_Cells.resolve(cell->getClosestCell()), m_Plants.resolve(cell->getClosestPlant()) };
+}
 
-		// getting entity information
-		unsigned nearbyCellCount = 0;
-		unsigned nearbyPlantCount = 0;
-		Cell* closestCell = filterAndProcessNearby(cell->getPosition(), m_nearbyCells, CellSettings::visualRadius, cell->getRadius(), nearbyCellCount);
-		Plant* closestPlant = filterAndProcessNearby(cell->getPosition(), m_nearbyPlants, PlantSettings::visualRange, cell->getRadius(), nearbyPlantCount);
 
-		// setting the information in the cell to be used for later
-		cell->setClosestEntities(closestCell, closestPlant, nearbyCellCount, nearbyPlantCount);
+void World::cellInference()
+{
+	switch (activation)
+	{
+	case Activation::Exact: runCellInference<Activation::Exact>(); break;
+	case Activation::Fast:  runCellInference<Activation::Fast>();  break;
+	case Activation::Tanh:  runCellInference<Activation::Tanh>();  break;
 	}
 }
 
 
-void Simulation::updateCells()
+template<Activation A>
+void World::runCellInference()
 {
-	for (Cell* cell : m_Cells)
+	// every cell gathers its inputs into the batch, then all of the networks are run together
+	m_cellNetworks.clearRequests();
+	m_threadPool.dispatch(m_Cells.size(), [this](const unsigned start, const unsigned end, unsigned)
 	{
-		cell->update();
+		for (unsigned i{ start }; i < end; i++)
+		{
+			const unsigned slot = m_Cells.liveSlot(i);
 
-		if (!cell->thermalToggle(m_thermal)) continue;
+			CellPerceptron::InputArray inputs;
+			if (!m_Cells.at(slot)->perceive(inputs, neighboursOf(m_Cells.at(slot))))
+				continue;
+
+			if (batchedInference)
+				m_cellNetworks.request(slot, inputs);
+			else
+				m_Cells.at(slot)->think<A>(inputs);
+		}
+	});
+
+	if (batchedInference)
+		m_cellNetworks.evaluate<A>([this](const unsigned slot) -> const CellPerceptron& { return m_Cells.at(slot)->getNetwork(); }, m_threadPool);
+}
+
+
+void World::updateCells()
+{
+	// every cell only writes to itself here, what it does to the entities it touches is stored in its contact
+	m_threadPool.dispatch(m_Cells.size(), [this](const unsigned start, const unsigned end, unsigned)
+	{
+		for (unsigned i{ start }; i < end; i++)
+		{
+			const unsigned slot = m_Cells.liveSlot(i);
+
+			Cell* cell = m_Cells.at(slot);
+			if (m_cellNetworks.isRequested(slot))
+				cell->networkOutputs() = m_cellNetworks.getOutputs(slot);
 
-		bufferColorUpdate({ cell->indexes }, cell->getColor());
+			cell->update(m_cellContacts[slot], neighboursOf(cell));
+		}
+	});
+
+	// the contacts are applied in the serial loop order, so the result is the same no matter how many threads were used
+	for (const Cell* cell : m_Cells)
+	{
+		const CellContact& contact = m_cellContacts[cell->vector_id];
+		contact.apply(m_Cells.resolve(contact.cell), m_Plants.resolve(contact.plant));
 	}
 
-	updateEntityPosition(m_Cells);
+	m_threadPool.dispatch(m_Cells.size(), [this](const unsigned start, const unsigned end, unsigned)
+	{
+		for (unsigned i{ start }; i < end; i++)
+			m_Cells.at(m_Cells.liveSlot(i))->endUpdate();
+	});
+
+	for (Cell* cell : m_Cells)
+	{
+		if (!cell->thermalToggle(m_thermal)) continue;
 
+		bufferColorUpdate(cell->getAllocations(), cell->getColor());
+	}
 
+	updateEntityPosition(m_Cells);
 }
 
 
-void Simulation::clearEntityData()
+void World::clearEntityData()
 {
 	// clearing the current simulation data
 	for (Cell* cell : m_Cells)    cell->die();
@@ -159,22 +323,20 @@ void Simulation::clearEntityData()
 
 	addAndRemoveEntities(m_Cells, true);
 	addAndRemoveEntities(m_Plants, false);
+	m_gridCurrent = false;
 }
 
 
 template<class E, unsigned N>
-void Simulation::updateEntityPosition(o_vector<E, N>& entities)
+void World::updateEntityPosition(o_vector<E, N>& entities)
 {
 	for (E* entity : entities)
-	{
 		entity->updatePositioning();
-		bufferPosUpdate({entity->indexes}, entity->getDeltaPos());
-	}
 }
 
 
 template<class E, unsigned N>
-void Simulation::addAndRemoveEntities(o_vector<E, N>& entities, const bool isCell) {
+void World::addAndRemoveEntities(o_vector<E, N>& entities, const bool isCell) {
 	for (E* entity : entities)
 	{
 		if (entity->isDead())
@@ -186,13 +348,13 @@ void Simulation::addAndRemoveEntities(o_vector<E, N>& entities, const bool isCel
 }
 
 
-void Simulation::overflowProtection(const unsigned maxcells, const unsigned maxplants)
+void World::overflowProtection(const unsigned maxcells, const unsigned maxplants)
 {
 	overflowCheckEntities(m_Cells, maxcells, true);
 	overflowCheckEntities(m_Plants, maxplants, false);
 }
 
-void Simulation::extinctionCheck()
+void World::extinctionCheck()
 {
 	// validating that we should proceed
 	if (!autoExtinctionReset || m_Cells.size() > 0 || maxCells == 0 || initCellCount == 0)
@@ -206,12 +368,14 @@ void Simulation::extinctionCheck()
 	{
 		Cell* cell = m_Cells.add();
 
-		const sf::Vector2f chosenPosition = randPosInRect(m_simBounds);
-		const sf::Vector2f deltaPosition = chosenPosition - cell->getPosition();
-		cell->setEntityPosition(chosenPosition);
+		// the slot was wiped when its cell was removed, which leaves it dead, start it from scratch like a spawned cell
+		cell->wipeData();
+		cell->revive();
+
+		Random rng = Random::forEntity(cell->vector_id, Random::CellSpawn);
+		cell->setEntityPosition(randPosInRect(rng, m_simBounds));
 
-		bufferPosUpdate({ cell->indexes }, deltaPosition);
-		bufferColorUpdate({ cell->indexes }, cell->getColor());
+		bufferColorUpdate(cell->getAllocations(), cell->getColor());
 	}
 
 	totalExtinctions++;
@@ -220,22 +384,27 @@ void Simulation::extinctionCheck()
 }
 
 template<class E, unsigned N>
-void Simulation::overflowCheckEntities(o_vector<E, N>& entities, const unsigned maxEntities, const bool type) {
+void World::overflowCheckEntities(o_vector<E, N>& entities, const unsigned maxEntities, const bool type) {
+	const Random::Stream stream = type ? Random::OverflowCells : Random::OverflowPlants;
+
+	unsigned pass = 0;
 	while (entities.size() > maxEntities)
 	{
 		for (E* entity : entities)
 		{
-			if (randint(0, 10) != 0) continue;
+			Random rng = Random::forEntity(entity->vector_id, stream, pass);
+			if (randint(rng, 0, 10) != 0) continue;
 			removeEntity(entity, type);
 
 			if (entities.size() <= maxEntities)
 				break;
 		}
+		pass++;
 	}
 }
 
 template<class E>
-void Simulation::removeEntity(E* entity, const bool type)
+void World::removeEntity(E* entity, const bool type)
 { // type : true = cell, type : false = plant
 	if (type == true)
 		m_Cells.remove(entity->vector_id);
@@ -244,29 +413,30 @@ void Simulation::removeEntity(E* entity, const bool type)
 
 	// the deathPos is where all the dead entities go to
 	const sf::Vector2f deathPos = { -100.f, -100.f };
-	const sf::Vector2f deltaPos = deathPos - entity->getPosition();
 	entity->setEntityPosition(deathPos);
-	bufferPosUpdate({ entity->indexes }, deltaPos);
 
 	entity->wipeData();
 }
 
 
 template<class E, unsigned N>
-bool Simulation::addEntity(o_vector<E, N>& entities, E* entity, const bool isCell)
+bool World::addEntity(o_vector<E, N>& entities, E* entity, const bool isCell)
 {
 	E* newEntity = entities.add();
 	if (newEntity == nullptr)
 		return false;
 
 	entity->reproduce(newEntity);
-	bufferPosUpdate({newEntity->indexes}, newEntity->getDeltaPos());
 
-	sf::Color color = Plant::generateColor();
+	// cells inherit a mutated colour in reproduce(), plants get a new one
 	if (isCell)
-		color = newEntity->getColor();
+	{
+		bufferColorUpdate(newEntity->getAllocations(), newEntity->getColor());
+		return true;
+	}
 
-	bufferColorUpdate({ newEntity->indexes }, color);
+	Random rng = Random::forEntity(entity->vector_id, Random::PlantReproduce, 1);
+	bufferColorUpdate(newEntity->getAllocations(), Plant::generateColor(rng));
 
 	return true;
 }
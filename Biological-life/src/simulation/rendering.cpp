@@ -3,6 +3,200 @@
 #include <SFML/Graphics.hpp>
 #include "../utility.hpp"
 
+#include <cmath>
+#include <sstream>
+
+
+Simulation::Simulation(const Settings& settings)
+	: World(settings, false),
+	ZoomManagement(m_simBounds, scaleFactor),
+	m_buffer(maxCells + maxPlants, objectCirclePoints, sf::VertexBuffer::Stream, true)
+{
+	// the entities are created here rather than in World() so that the buffer hooks below are used for them
+	initLife();
+	initDebuging();
+	initGridRender();
+}
+
+
+void Simulation::run()
+{
+	while (!m_closeSim)
+	{
+		if (!m_paused)
+		{
+			// allows the user to manually tick through frames
+			if (m_frameByFrame)
+			{
+				runTick();
+				m_paused = true;
+			}
+			else
+				m_scheduler.runFrame([this] { runTick(); });
+		}
+		else
+			endFrame(GetDelta(), true);
+
+		// the vertices are only placed and uploaded once per presented frame no matter how many ticks were run. This
+		// happens while paused as well since moving the camera changes what is culled
+		m_profiler.measure(Phase::GenerateVertices, [this] { generateVertices(); });
+		m_profiler.measure(Phase::BufferUpdate, [this] { m_buffer.update(); });
+
+		m_scheduler.beginRender();
+		renderFrame();
+		m_scheduler.endRender();
+	}
+}
+
+
+void Simulation::runTick()
+{
+	tick(GetDelta());
+}
+
+
+void Simulation::initDebuging()
+{
+	// debug circle for entity center, and the outline widths of the visual range and size rings
+	m_debugCenterRadius = 2.f * scaleFactor;
+	m_debugVRangeThickness = .6f * scaleFactor;
+	m_debugSizeThickness = .4f * scaleFactor;
+
+	constexpr float PI = 3.14159265f;
+	for (unsigned i{ 0 }; i <= debugCirclePoints; i++)
+	{
+		const float angle = 2.f * PI * static_cast<float>(i % debugCirclePoints) / static_cast<float>(debugCirclePoints);
+		m_debugCircle.emplace_back(std::cos(angle), std::sin(angle));
+	}
+}
+
+
+void Simulation::initGridRender()
+{
+	const sf::Vector2u cellsXY = m_hashGrid.m_cellsXY;
+	const sf::Vector2f cellDimensions = m_hashGrid.m_cellDimensions;
+	const sf::Rect<float> screenSize = m_hashGrid.m_screenSize;
+
+	std::vector<sf::Vertex> vertices(static_cast<std::vector<sf::Vertex>::size_type>((cellsXY.x + cellsXY.y) * 2) + 10);
+
+	m_renderGrid = sf::VertexBuffer(sf::Lines, sf::VertexBuffer::Static);
+	m_renderGrid.create(vertices.size());
+
+	size_t counter = 0;
+	for (unsigned i = 0; i <= cellsXY.x; i++)
+	{
+		const float posX = static_cast<float>(i) * cellDimensions.x;
+		vertices[counter].position = { posX, 0 };
+		vertices[counter + 1].position = { screenSize.left + posX, screenSize.top + screenSize.height };
+		counter += 2;
+	}
+
+	for (unsigned i = 0; i <= cellsXY.y; i++)
+	{
+		const float posY = static_cast<float>(i) * cellDimensions.y;
+		vertices[counter].position = { 0, posY };
+		vertices[counter + 1].position = { screenSize.left + screenSize.width, screenSize.top + posY };
+		counter += 2;
+	}
+
+	m_renderGrid.update(vertices.data(), vertices.size(), 0);
+}
+
+
+void Simulation::findVisibleEntities()
+{
+	m_visibleCells.clear();
+	m_visiblePlants.clear();
+
+	// the margin is wide enough for anything just off screen that reaches into it, vision rings included
+	const sf::View& view = m_window.getView();
+	const sf::Rect<float> viewArea{ view.getCenter() - view.getSize() / 2.f, view.getSize() };
+	constexpr float margin = CellSettings::visualRadius;
+	m_visibleArea = resizeRect(getVisibleArea(viewArea), { -margin, -margin });
+
+	// when the whole world is on screen every entity is visible anyway
+	const sf::Rect<float>& world = m_hashGrid.m_screenSize;
+	if (m_visibleArea.left <= world.left && m_visibleArea.top <= world.top &&
+		m_visibleArea.left + m_visibleArea.width >= world.left + world.width &&
+		m_visibleArea.top + m_visibleArea.height >= world.top + world.height)
+	{
+		for (const Plant* plant : m_Plants) m_visiblePlants.push_back(plant->vector_id);
+		for (const Cell* cell : m_Cells)    m_visibleCells.push_back(cell->vector_id);
+		return;
+	}
+
+	// the grid is rebuilt if a tick has run since, otherwise anything born in that tick wouldn't be in it. It is always
+	// built lossless here, an entity dropped from a full grid cell would disappear from the screen
+	if (!m_gridCurrent)
+		buildGrid(true);
+
+	forEachInArea(m_visibleArea, [this](const unsigned slot, const bool isCell)
+	{
+		if (isCell)
+			m_visibleCells.push_back(slot);
+		else
+			m_visiblePlants.push_back(slot);
+	});
+}
+
+
+Buffer::Detail Simulation::chooseDetail() const
+{
+	// a newborn cell's size on screen, zoomed all the way out it is only a pixel or two across
+	const float pixels = (PlantSettings::initMass + 4) * 2.f * getScroll();
+
+	if (pixels < lowDetailPixels)
+		return Buffer::Detail::Point;
+	if (pixels < fullDetailPixels)
+		return Buffer::Detail::Low;
+	return Buffer::Detail::Full;
+}
+
+
+void Simulation::generateVertices()
+{
+	m_buffer.setDetail(chooseDetail());
+	findVisibleEntities();
+	generateVertices(m_Cells, m_visibleCells);
+	generateVertices(m_Plants, m_visiblePlants);
+
+	// the dead and culled entities weren't placed so they are dropped here, then only the objects that changed are
+	// expanded into vertices, each one owns its own run of them
+	m_buffer.arrange();
+	m_threadPool.dispatch(m_buffer.getDrawnCount(), [this](const unsigned start, const unsigned end, unsigned)
+	{
+		m_buffer.expand(start, end);
+	});
+}
+
+template<class E, unsigned N>
+void Simulation::generateVertices(o_vector<E, N>& entities, const std::vector<unsigned>& visible)
+{
+	/* every visible entity's instance is set to where it actually is, they are all separate so the entities can be
+	 * split between the threads */
+	m_threadPool.dispatch(static_cast<unsigned>(visible.size()), [this, &entities, &visible](const unsigned start, const unsigned end, unsigned)
+	{
+		for (unsigned i{ start }; i < end; i++)
+		{
+			const E* entity = entities.at(visible[i]);
+			m_buffer.setShape(entity->getAllocations(), entity->getPosition(), entity->getRadius());
+		}
+	});
+}
+
+
+Allocations Simulation::allocateEntity(const sf::Vector2f position, const float radius, const sf::Color color)
+{
+	return m_buffer.add(position, radius, color);
+}
+
+void Simulation::bufferColorUpdate(const Allocations& entityAllocations, const sf::Color newColor)
+{
+	m_buffer.setColor(entityAllocations, newColor);
+}
+
+
+
 void Simulation::pollEvents()
 {
 	const sf::Vector2f delta = updateMousePos(getMousePositionFloat(m_window));
@@ -31,23 +225,6 @@ void Simulation::pollEvents()
 }
 
 
-void Simulation::updateCellStatistics()
-{
-	float offspringSum = 0;
-	float ageSum = 0;
-
-	for (const Cell* cell : m_Cells)
-	{
-		offspringSum += static_cast<float>(cell->offspringCount);
-		ageSum += static_cast<float>(cell->getAge());
-	}
-
-	const auto size = static_cast<float>(m_Cells.size());
-	avgLifeTime.push_back(ageSum / size);
-	avgReproCount.push_back(offspringSum / size);
-}
-
-
 void Simulation::keyPressEvents(const sf::Keyboard::Key& event_key_code)
 {
 	const bool shifting = sf::Keyboard::isKeyPressed(sf::Keyboard::LShift);
@@ -82,6 +259,18 @@ void Simulation::keyPressEvents(const sf::Keyboard::Key& event_key_code)
 
 		break;
 
+	case sf::Keyboard::Key::M:
+		m_scheduler.toggleMode();
+		break;
+
+	case sf::Keyboard::Key::Up:
+		m_scheduler.increaseTicks();
+		break;
+
+	case sf::Keyboard::Key::Down:
+		m_scheduler.decreaseTicks();
+		break;
+
 	case sf::Keyboard::Key::V:
 		if (shifting)
 			m_debugVRangeToggle = not m_debugVRangeToggle;
@@ -125,6 +314,11 @@ void Simulation::keyPressEvents(const sf::Keyboard::Key& event_key_code)
 			loadData();
 		break;
 
+	case sf::Keyboard::Key::P:
+		if (ctrl)
+			exportTrace();
+		break;
+
 
 
 	default:
@@ -140,56 +334,92 @@ void Simulation::renderFrame()
 
 	pollEvents();
 
-	m_window.draw(*m_buffer.getBuffer(), getStates());
+	m_buffer.render(&m_window, getStates());
 
 	debugEntities();
 
 	// drawing grid
 	if (m_drawGrid)
-		m_window.draw(m_hashGrid.m_renderGrid, getStates());
+		drawGridLines();
 
 	if (m_debugBorder)
 		drawRectOutline(m_simBounds, m_window, getStates());
 
-	displayFrameRate(m_window, "Cellular Simulation", m_clock);
+	displayFrameRate(m_window, getTitle(), m_clock);
 	m_window.display();
 }
 
 
+std::string Simulation::getTitle() const
+{
+	std::ostringstream oss;
+	oss << "Cellular Simulation | " << m_scheduler.getLastTickCount() << " ticks/frame";
+	if (m_scheduler.getMode() == TickScheduler::Mode::FrameBudget)
+		oss << " (budget)";
+	oss << " | " << m_buffer.getDrawnCount() << " drawn, " << m_buffer.getBytesUploaded() / 1024 << " KiB uploaded in "
+	    << m_buffer.getUploadCount() << " ranges";
+	return oss.str();
+}
+
+
+void Simulation::drawGridLines()
+{
+	// the vertical lines come first in m_renderGrid then the horizontal ones, two vertices each, so the lines crossing
+	// the visible area are one range of each
+	const sf::Vector2u cellsXY = m_hashGrid.m_cellsXY;
+	const sf::Vector2f cellDimensions = m_hashGrid.m_cellDimensions;
+
+	const auto lineRange = [](const float start, const float length, const float spacing, const unsigned lines) -> std::pair<size_t, size_t>
+	{
+		const auto first = static_cast<size_t>(std::clamp(std::ceil(start / spacing), 0.f, static_cast<float>(lines)));
+		const auto last = static_cast<size_t>(std::clamp(std::floor((start + length) / spacing), 0.f, static_cast<float>(lines)));
+		return { first, last };
+	};
+
+	const auto [firstX, lastX] = lineRange(m_visibleArea.left, m_visibleArea.width, cellDimensions.x, cellsXY.x);
+	const auto [firstY, lastY] = lineRange(m_visibleArea.top, m_visibleArea.height, cellDimensions.y, cellsXY.y);
+	const size_t horizontal = (static_cast<size_t>(cellsXY.x) + 1) * 2;
+
+	m_window.draw(m_renderGrid, firstX * 2, (lastX - firstX + 1) * 2, getStates());
+	m_window.draw(m_renderGrid, horizontal + firstY * 2, (lastY - firstY + 1) * 2, getStates());
+}
+
+
 void Simulation::debugEntities()
 {
-	for (const Plant* plant : m_Plants)
-		debugEntity(plant, PlantSettings::visualRange, PlantSettings::initMass);
+	// the containers keep their capacity, so after the first frame this doesn't allocate
+	m_debugTriangles.clear();
+	m_debugLines.clear();
+
+	if (!m_debugCenterToggle && !m_debugVRangeToggle && !m_debugCircToggle && !m_debugVelToggle && !m_debugClosestToggle)
+		return;
 
-	for (const Cell* cell : m_Cells)
-		debugEntity(cell, CellSettings::visualRadius, cell->getRadius());
+	for (const unsigned slot : m_visiblePlants)
+		debugEntity(m_Plants.at(slot), PlantSettings::visualRange, PlantSettings::initMass);
+
+	for (const unsigned slot : m_visibleCells)
+		debugEntity(m_Cells.at(slot), CellSettings::visualRadius, m_Cells.at(slot)->getRadius());
+
+	if (!m_debugTriangles.empty())
+		m_window.draw(m_debugTriangles.data(), m_debugTriangles.size(), sf::Triangles, getStates());
+
+	if (!m_debugLines.empty())
+		m_window.draw(m_debugLines.data(), m_debugLines.size(), sf::Lines, getStates());
 }
 
 
 void Simulation::debugEntity(const Entity* entity, const float vrange, const float initRad)
 {
-	const float rad = debugCircle.getRadius();
 	const sf::Vector2f position = entity->getPosition();
 
 	if (m_debugCenterToggle)
-	{
-		debugCircle.setPosition(position - sf::Vector2f{ rad, rad });
-		m_window.draw(debugCircle, getStates());
-	}
+		addDebugDisc(position, m_debugCenterRadius, { 255, 0, 0 });
 
 	if (m_debugVRangeToggle)
-	{
-		debugVRange.setPosition(position - sf::Vector2f{ vrange, vrange });
-		debugVRange.setRadius(vrange);
-		m_window.draw(debugVRange, getStates());
-	}
+		addDebugRing(position, vrange, m_debugVRangeThickness, { 255, 0, 0 });
 
 	if (m_debugCircToggle)
-	{
-		debugCircleSize.setPosition(position - sf::Vector2f{ initRad, initRad });
-		debugCircleSize.setRadius(initRad);
-		m_window.draw(debugCircleSize, getStates());
-	}
+		addDebugRing(position, initRad, m_debugSizeThickness, { 255, 0, 0 });
 
 	if (m_debugVelToggle)
 	{
@@ -198,13 +428,50 @@ void Simulation::debugEntity(const Entity* entity, const float vrange, const flo
 		const sf::Vector2f velocity = normaliseVector(entity->getVelocity(), normLength);
 		const sf::Vector2f displacement = normaliseVector(entity->getDisplacement(), normLength);
 
-		m_window.draw(makeLine(position, position + velocity    , { 255, 0  , 255 }), getStates());
-		m_window.draw(makeLine(position, position + displacement, { 0, 255, 100 }), getStates());
+		addDebugLine(position, position + velocity    , { 255, 0  , 255 });
+		addDebugLine(position, position + displacement, { 0, 255, 100 });
 	}
 
 	if (m_debugClosestToggle)
+		addDebugLine(position, entity->getClosestPos(), { 0, 0, 255 });
+}
+
+
+void Simulation::addDebugDisc(const sf::Vector2f center, const float radius, const sf::Color color)
+{
+	for (unsigned i{ 0 }; i < debugCirclePoints; i++)
 	{
-		const sf::VertexArray velLine = makeLine(position, entity->getClosestPos(), { 0, 0, 255 });
-		m_window.draw(velLine, getStates());
+		m_debugTriangles.emplace_back(center, color);
+		m_debugTriangles.emplace_back(center + m_debugCircle[i] * radius, color);
+		m_debugTriangles.emplace_back(center + m_debugCircle[i + 1] * radius, color);
 	}
+}
+
+
+void Simulation::addDebugRing(const sf::Vector2f center, const float radius, const float thickness, const sf::Color color)
+{
+	// the ring grows outwards from radius like an sf::CircleShape outline, two triangles per segment
+	const float outer = radius + thickness;
+	for (unsigned i{ 0 }; i < debugCirclePoints; i++)
+	{
+		const sf::Vector2f inner0 = center + m_debugCircle[i] * radius;
+		const sf::Vector2f inner1 = center + m_debugCircle[i + 1] * radius;
+		const sf::Vector2f outer0 = center + m_debugCircle[i] * outer;
+		const sf::Vector2f outer1 = center + m_debugCircle[i + 1] * outer;
+
+		m_debugTriangles.emplace_back(inner0, color);
+		m_debugTriangles.emplace_back(outer0, color);
+		m_debugTriangles.emplace_back(outer1, color);
+
+		m_debugTriangles.emplace_back(inner0, color);
+		m_debugTriangles.emplace_back(outer1, color);
+		m_debugTriangles.emplace_back(inner1, color);
+	}
+}
+
+
+void Simulation::addDebugLine(const sf::Vector2f start, const sf::Vector2f end, const sf::Color color)
+{
+	m_debugLines.emplace_back(start, color);
+	m_debugLines.emplace_back(end, color);
 }
\ No newline at end of file
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <algorithm>
+
+/*
+A class dedicated to deciding how many simulation ticks are run for every rendered frame
+modes:
+- TicksPerFrame: exactly m_ticksPerFrame ticks are run before the frame is presented
+- FrameBudget:   ticks are run until the frame budget (target frame time minus the last render time) is used up
+ */
+
+class TickScheduler
+{
+public:
+	enum class Mode { TicksPerFrame, FrameBudget };
+
+private:
+	using clock = std::chrono::high_resolution_clock;
+
+	Mode m_mode = Mode::TicksPerFrame;
+	unsigned m_ticksPerFrame = 1;
+
+	const double m_targetFrameTime;  // seconds per presented frame in FrameBudget mode
+	const unsigned m_maxTicksPerFrame = 4'096;
+
+	double m_lastRenderTime = 0;
+	unsigned m_lastTickCount = 0;
+	clock::time_point m_renderStart{};
+
+
+public:
+	explicit TickScheduler(const double targetFrameRate = 60.0)
+		: m_targetFrameTime(1.0 / targetFrameRate) {}
+
+	// runs tickFunction as many times as the current mode allows, returns the number of ticks run
+	template<class TickFunction>
+	unsigned runFrame(TickFunction&& tickFunction)
+	{
+		unsigned ticks = 0;
+
+		if (m_mode == Mode::TicksPerFrame)
+		{
+			for (; ticks < m_ticksPerFrame; ticks++)
+				tickFunction();
+		}
+
+		else
+		{
+			// always run at least one tick so the simulation keeps moving even if rendering eats the whole budget
+			const double budget = m_targetFrameTime - m_lastRenderTime;
+			const clock::time_point start = clock::now();
+			do
+			{
+				tickFunction();
+				ticks++;
+			} while (ticks < m_maxTicksPerFrame && secondsSince(start) < budget);
+		}
+
+		m_lastTickCount = ticks;
+		return ticks;
+	}
+
+	// wrapped around the rendering of a frame so the budget mode knows how much time is left for ticking
+	void beginRender() { m_renderStart = clock::now(); }
+	void endRender()   { m_lastRenderTime = secondsSince(m_renderStart); }
+
+	void toggleMode()
+	{
+		m_mode = m_mode == Mode::TicksPerFrame ? Mode::FrameBudget : Mode::TicksPerFrame;
+	}
+
+	void increaseTicks() { m_ticksPerFrame = std::min(m_ticksPerFrame * 2, m_maxTicksPerFrame); }
+	void decreaseTicks() { m_ticksPerFrame = std::max(m_ticksPerFrame / 2, 1u); }
+
+	[[nodiscard]] Mode getMode() const { return m_mode; }
+	[[nodiscard]] unsigned getLastTickCount() const { return m_lastTickCount; }
+
+
+private:
+	static double secondsSince(const clock::time_point start)
+	{
+		return std::chrono::duration<double>(clock::now() - start).count();
+	}
+};
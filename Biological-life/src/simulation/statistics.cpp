@@ -1,6 +1,6 @@
-#include "Simulation.hpp"
+#include "World.hpp"
 
-void Simulation::initStatisticVariables()
+void World::initStatisticVariables()
 {
 	cellPopulation.reserve(20'000);
 	plantPopulation.reserve(20'000);
@@ -13,7 +13,7 @@ void Simulation::initStatisticVariables()
 	avgLifeTime.push_back(0);
 }
 
-void Simulation::saveData()
+void World::saveData()
 {
 	nlohmann::json entityData;
 	for (Cell* cell : m_Cells)
@@ -27,6 +27,7 @@ void Simulation::saveData()
 		{"total frame count", totalFrameCount},
 		{"total extinctions", totalExtinctions},
 		{"total run time", totalRunTime},
+		{"seed", Random::getSeed()},
 		{"entities", entityData}
 	};
 
@@ -36,7 +37,7 @@ void Simulation::saveData()
 }
 
 
-void Simulation::loadData()
+void World::loadData()
 {
 	clearEntityData();
 
@@ -47,6 +48,11 @@ void Simulation::loadData()
 	totalExtinctions = simulationData["total extinctions"];
 	totalRunTime = simulationData["total run time"];
 
+	// older saves were made before the seed was recorded
+	if (simulationData.contains("seed"))
+		Random::setSeed(simulationData["seed"].get<uint64_t>());
+	Random::setTick(totalFrameCount);
+
 	unsigned i = 0;
 	for (const nlohmann::json& cellData : simulationData["entities"])
 	{
@@ -55,18 +61,36 @@ void Simulation::loadData()
 			break;
 
 		newCell->loadCellData(cellData);
-		bufferPosUpdate({ newCell->indexes }, newCell->getDeltaPos());
-		bufferColorUpdate({ newCell->indexes }, newCell->getColor());
+		bufferColorUpdate(newCell->getAllocations(), newCell->getColor());
 		i++;
 	}
 
-	alignCells();
-
 	plantUnderflowProtection(initPlantCount);
 }
 
 
-void Simulation::printStatistics()
+std::size_t World::computeChecksum()
+{
+	std::size_t seed = 0;
+	for (const Cell* cell : m_Cells)
+	{
+		boost::hash_combine(seed, cell->vector_id);
+		boost::hash_combine(seed, cell->getPosition().x);
+		boost::hash_combine(seed, cell->getPosition().y);
+	}
+
+	for (const Plant* plant : m_Plants)
+	{
+		boost::hash_combine(seed, plant->vector_id);
+		boost::hash_combine(seed, plant->getPosition().x);
+		boost::hash_combine(seed, plant->getPosition().y);
+	}
+
+	return seed;
+}
+
+
+void World::printStatistics()
 {
 	std::cout << "-------------------------------------------------- " << ++updateCounter << "\n";
 	std::cout << "Total Alive : " << m_Cells.size() << " Cells, " << m_Plants.size() << " Plants" << "\n";
@@ -77,16 +101,49 @@ void Simulation::printStatistics()
 	std::cout << "Avg age     : " << roundToNearestN(static_cast<double>(avgLifeTime.at(avgLifeTime.size() - 1)), 1)    << "\n";
 	std::cout << "Time Passed : " << roundToNearestN(totalRunTime / 60, 2)   << " mins \n";
 	std::cout << "            : " << roundToNearestN(totalRunTime / 3600, 2) << " hours \n";
+	printGridOverflow();
 	std::cout << "\n";
 }
 
 
-void Simulation::updateStatistics()
+void World::printGridOverflow() const
+{
+	const GridOverflowStats& overflow = m_gridOverflow;
+	if (overflow.overflowedRebuilds == 0)
+		return;
+
+	const uint32_t worst = overflow.worstCell();
+	std::cout << "Grid overflow: " << overflow.overflowedRebuilds << " / " << overflow.rebuilds << " rebuilds, "
+		<< overflow.overflowedAtoms << " ids past capacity, max occupancy " << overflow.maxOccupancy
+		<< " (capacity " << GridOverflowStats::capacity << ")" << "\n";
+	std::cout << "worst cell   : (" << worst % hashCells.x << ", " << worst / hashCells.x << ") overflowed "
+		<< overflow.cellOverflows[worst] << " times" << "\n";
+}
+
+
+void World::updateCellStatistics()
+{
+	float offspringSum = 0;
+	float ageSum = 0;
+
+	for (const Cell* cell : m_Cells)
+	{
+		offspringSum += static_cast<float>(cell->offspringCount);
+		ageSum += static_cast<float>(cell->getAge());
+	}
+
+	const auto size = static_cast<float>(m_Cells.size());
+	avgLifeTime.push_back(ageSum / size);
+	avgReproCount.push_back(offspringSum / size);
+}
+
+
+void World::updateStatistics()
 {
 	constexpr unsigned printFreq = 1'000;
 	constexpr unsigned saveFreq = 2'000;
 
-	if (totalFrameCount % printFreq == 0 && !m_paused)
+	if (totalFrameCount % printFreq == 0)
 	{
 		// updating the current statistics
 		cellPopulation.push_back(m_Cells.size());
@@ -102,7 +159,7 @@ void Simulation::updateStatistics()
 	//	std::cout << "min plants: " << minPlants << "\n";
 	//}
 
-	if (totalFrameCount % saveFreq == 0 && !m_paused && m_autoSaving)
+	if (totalFrameCount % saveFreq == 0 && m_autoSaving)
 	{
 		std::cout << "Autosaving. . ." << "\n";
 		saveData();
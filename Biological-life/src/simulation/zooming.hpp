@@ -40,6 +40,13 @@ public:
 
 
 	sf::RenderStates& getStates() { return m_renderStates; }
+	[[nodiscard]] float getScroll() const { return m_currentScroll; } // how many pixels one unit of the surface is
+
+	// the part of the surface that ends up inside viewArea (the view's rect) once the zoom and translation are applied
+	[[nodiscard]] sf::Rect<float> getVisibleArea(const sf::Rect<float>& viewArea) const
+	{
+		return m_renderStates.transform.getInverse().transformRect(viewArea);
+	}
 
 
 	void update(const sf::Vector2f& offset, const float scale)
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+	ThreadPool
+
+	a small fork/join pool in the style of the one used by VerletSFML-Multithread. dispatch() splits a range of
+	elements into chunks, the calling thread and the workers pull chunks until none are left and dispatch() only
+	returns once every chunk has been processed.
+
+	the callback is given (start, end, threadIndex), threadIndex is in [0, size()) and is unique to the thread running
+	the chunk, so it can be used to index per-thread scratch buffers.
+*/
+
+
+class ThreadPool
+{
+	std::vector<std::thread> m_workers;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+
+	std::function<void(unsigned, unsigned, unsigned)> m_task;
+	unsigned m_elementCount = 0;
+	unsigned m_chunkSize = 0;
+	unsigned m_chunkCount = 0;
+	std::atomic<unsigned> m_nextChunk = 0;
+
+	unsigned long long m_generation = 0;
+	unsigned m_finishedWorkers = 0;
+	bool m_stop = false;
+
+	// more chunks than threads so a thread that finishes early can pick up more work
+	static constexpr unsigned chunksPerThread = 4;
+
+
+public:
+	// the most threads a command line may ask for, anything past this is a typo rather than a machine
+	static constexpr unsigned maxThreads = 1024;
+
+	// threadCount includes the calling thread, 0 uses every hardware thread
+	explicit ThreadPool(unsigned threadCount = 0)
+	{
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+		m_workers.reserve(threadCount - 1);
+		for (unsigned i{ 1 }; i < threadCount; i++)
+			m_workers.emplace_back([this, i] { workerLoop(i); });
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_stop = true;
+		}
+		m_wake.notify_all();
+
+		for (std::thread& worker : m_workers)
+			worker.join();
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	[[nodiscard]] unsigned size() const { return static_cast<unsigned>(m_workers.size()) + 1; }
+
+
+	template<class Callback>
+	void dispatch(const unsigned elementCount, Callback&& callback)
+	{
+		if (elementCount == 0)
+			return;
+
+		// nothing to gain from waking the workers
+		if (m_workers.empty() || elementCount < size())
+		{
+			callback(0u, elementCount, 0u);
+			return;
+		}
+
+		{
+			std::lock_guard lock(m_mutex);
+			m_task = std::forward<Callback>(callback);
+			m_elementCount = elementCount;
+			m_chunkCount = std::min(elementCount, size() * chunksPerThread);
+			m_chunkSize = (elementCount + m_chunkCount - 1) / m_chunkCount;
+			m_nextChunk = 0;
+			m_finishedWorkers = 0;
+			m_generation++;
+		}
+		m_wake.notify_all();
+
+		runChunks(0);
+
+		// every worker has to report in before the next dispatch can safely replace the task
+		std::unique_lock lock(m_mutex);
+		m_done.wait(lock, [this] { return m_finishedWorkers == m_workers.size(); });
+		m_task = nullptr;
+	}
+
+
+private:
+	void workerLoop(const unsigned threadIndex)
+	{
+		unsigned long long seenGeneration = 0;
+		while (true)
+		{
+			{
+				std::unique_lock lock(m_mutex);
+				m_wake.wait(lock, [&] { return m_stop || m_generation != seenGeneration; });
+				if (m_stop)
+					return;
+				seenGeneration = m_generation;
+			}
+
+			runChunks(threadIndex);
+
+			{
+				std::lock_guard lock(m_mutex);
+				m_finishedWorkers++;
+			}
+			m_done.notify_one();
+		}
+	}
+
+	void runChunks(const unsigned threadIndex)
+	{
+		while (true)
+		{
+			const unsigned chunk = m_nextChunk.fetch_add(1);
+			if (chunk >= m_chunkCount)
+				return;
+
+			const unsigned start = chunk * m_chunkSize;
+			const unsigned end = std::min(start + m_chunkSize, m_elementCount);
+			if (start < end)
+				m_task(start, end, threadIndex);
+		}
+	}
+};
@@ -5,6 +5,12 @@
 #include <cmath>
 #include <boost/functional/hash.hpp>
 #include <functional>
+#include <span>
+#include <charconv>
+#include <cstring>
+#include <limits>
+
+#include "random.hpp"
 
 
 inline float dot(const sf::Vector2f& v1, const sf::Vector2f& v2)
@@ -28,35 +34,35 @@ inline sf::Vector2f normalize(const sf::Vector2f& v)
 	return (len > 0.f) ? v / len : v;
 }
 
-// random
-inline int randint(const int start, const int end) {
-	return rand() % (end - start) + start;
+// random, every draw goes through a Random so that it is reproducible from the seed (see random.hpp)
+inline int randint(Random& rng, const int start, const int end) {
+	return rng.nextInt(start, end);
 }
 
-inline float randfloat(const float start, const float end)
+inline float randfloat(Random& rng, const float start, const float end)
 {
-	return (static_cast<float>(rand()) / static_cast<float>(RAND_MAX) * (end - start)) + start;
+	return rng.nextFloat() * (end - start) + start;
 }
 
-inline sf::Vector2f randVector(const float start1, const float end1, const float start2, const float end2)
+inline sf::Vector2f randVector(Random& rng, const float start1, const float end1, const float start2, const float end2)
 {
-	return { randfloat(start1, end1), randfloat(start2, end2) };
+	return { randfloat(rng, start1, end1), randfloat(rng, start2, end2) };
 }
 
-inline sf::Vector2f randPosInRect(const sf::Rect<float> rect)
+inline sf::Vector2f randPosInRect(Random& rng, const sf::Rect<float> rect)
 {
-	return randVector(rect.left, rect.left + rect.width, rect.top, rect.top + rect.height);
+	return randVector(rng, rect.left, rect.left + rect.width, rect.top, rect.top + rect.height);
 }
 
 
-inline sf::Color randColor(
+inline sf::Color randColor(Random& rng,
 	const float rMin = 0, const float rMax = 255, const float gMin = 0, const float gMax = 255, 
 	const float bMin = 0, const float bMax = 255)
 {
 	return {
-		static_cast<sf::Uint8>(randfloat(rMin, rMax)),
-		static_cast<sf::Uint8>(randfloat(gMin, gMax)),
-		static_cast<sf::Uint8>(randfloat(bMin, bMax))
+		static_cast<sf::Uint8>(randfloat(rng, rMin, rMax)),
+		static_cast<sf::Uint8>(randfloat(rng, gMin, gMax)),
+		static_cast<sf::Uint8>(randfloat(rng, bMin, bMax))
 	};
 }
 
@@ -132,6 +138,16 @@ inline sf::VertexArray makeLine(const sf::Vector2f& point1, const sf::Vector2f&
 }
 
 
+// reads a whole command line argument as a number no bigger than max, false if it isn't one (a sign, a trailing
+// character, out of range)
+inline bool parseArgument(const char* text, uint64_t& value, const uint64_t max = std::numeric_limits<uint64_t>::max())
+{
+	const char* end = text + std::strlen(text);
+	const auto [last, error] = std::from_chars(text, end, value);
+	return error == std::errc() && last == end && value <= max;
+}
+
+
 inline std::string formatVariables(const std::vector<std::pair<std::string, double>>& variables) {
 	std::ostringstream oss;
 	oss.precision(2);
@@ -235,7 +251,7 @@ inline float generaeteUniqueIdentifier(const std::vector<float>& numbers)
 }
 
 
-inline float cosineSimilarity(const std::vector<float>& weights1, const std::vector<float>& weights2)
+inline float cosineSimilarity(const std::span<const float> weights1, const std::span<const float> weights2)
 {
 	if (weights1.size() != weights2.size())
 		return 0.0f;
@@ -260,7 +276,7 @@ inline float cosineSimilarity(const std::vector<float>& weights1, const std::vec
 	return dotProduct / (normWeights1 * normWeights2);
 }
 
-inline float generateUniqueIdentifier(const std::vector<float>& weights)
+inline float generateUniqueIdentifier(const std::span<const float> weights)
 {
 	// Calculate the similarity between weights and a reference vector (e.g., average weights)
 	std::vector<float> referenceWeights(weights.size(), 0.5f);  // Replace with your reference weights